@@ -3,40 +3,62 @@
 #include "rendersystem.hpp"
 #include "pointlightsystem.hpp"
 #include "buffer.hpp"
+#include "frameringbuffer.hpp"
+#include "geometryarena.hpp"
+#include "pipelineregistry.hpp"
+#include "pipelinecache.hpp"
+#include "uploadbatcher.hpp"
 #include "input.hpp"
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 #include <stdexcept>
+#include <algorithm>
 #include <array>
 #include <chrono>
 #include <cassert>
+#include <iostream>
 
 namespace ToyBox {
-    Application::Application() {
-        globalPool = DescriptorPool::Builder(device).setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT).addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT).build();
+    Application::Application(unsigned int recordThreads) : renderer{ window, device, recordThreads } {
+        globalPool = DescriptorPool::Builder(device).setMaxSets(1).addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1).build();
+        modelLoader.setResidencyManager(&residencyManager);
+
+        // entities are culled and drawn on the gpu when the device can, debug builds compare the culling with the cpu reference
+        if (device.isDrawIndirectCountSupported()) {
+            try {
+                gpuScene = std::make_unique<GpuScene>(device);
+                gpuScene->setResidencyManager(&residencyManager);
+                gpuScene->setValidation(device.enableValidationLayers);
+            }
+            catch (const std::exception& e) {
+                std::cerr << "gpu scene unavailable, culling on the cpu: " << e.what() << std::endl;
+            }
+        }
         loadEntities(); 
     }
 
     Application::~Application() {}
 
 	void Application::run() {
-        std::vector<std::unique_ptr<Buffer>> uboBuffers(SwapChain::MAX_FRAMES_IN_FLIGHT);
-        for (int i = 0; i < uboBuffers.size(); i++) {
-            uboBuffers[i] = std::make_unique<Buffer>(device, sizeof(GlobalUbo), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-            uboBuffers[i]->map();
-        }
-
-        auto globalSetLayout = DescriptorSetLayout::Builder(device).addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS).build();
-        std::vector<VkDescriptorSet> globalDescriptorSets(SwapChain::MAX_FRAMES_IN_FLIGHT);
-        for (int i = 0; i < globalDescriptorSets.size(); i++) {
-            auto bufferInfo = uboBuffers[i]->descriptorInfo();
-            DescriptorWriter(*globalSetLayout, *globalPool).writeBuffer(0, &bufferInfo).build(globalDescriptorSets[i]);
-        }
-
-		RenderSystem renderSys{ device, renderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout() };
-        PointLightSystem pointLightSys{ device, renderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout() };
+        // per-frame data is suballocated from one persistently mapped ring, the global ubo is bound at a dynamic offset into it.
+        // a partition has room for the gpu scene to upload every starting entity in one frame, larger uploads are spread over frames
+        VkDeviceSize frameSize = FrameRingBuffer::DEFAULT_FRAME_SIZE;
+        if (gpuScene) frameSize += GpuScene::getUploadSize(gameEntities.size());
+        FrameRingBuffer frameRing{ device, frameSize };
+        auto globalSetLayout = DescriptorSetLayout::Builder(device).addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_ALL_GRAPHICS).build();
+        VkDescriptorSet globalDescriptorSet = VK_NULL_HANDLE;
+        auto bufferInfo = frameRing.descriptorInfo(sizeof(GlobalUbo));
+        DescriptorWriter(*globalSetLayout, *globalPool).writeBuffer(0, &bufferInfo).build(globalDescriptorSet);
+
+        // the systems share identical pipelines through the registry, which builds them on worker threads; systems only wait for them when they first draw
+        PipelineRegistry pipelineRegistry{ device };
+        PipelineBuilder& pipelineBuilder = pipelineRegistry.getBuilder();
+		RenderSystem renderSys{ device, pipelineRegistry, renderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout() };
+        renderSys.setResidencyManager(&residencyManager);
+        renderSys.setGpuScene(gpuScene.get());
+        PointLightSystem pointLightSys{ device, pipelineRegistry, renderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout() };
         Camera camera = {};
         
         camera.setViewTarget(glm::vec3(-1.f, -2.f, 2.f), glm::vec3(0.f, 0.f, 2.5f));
@@ -48,9 +70,20 @@ namespace ToyBox {
 
         // for game loop timing
         auto currentTime = std::chrono::high_resolution_clock::now();
+        bool firstFrame = true;
+        bool loadingModels = true;
+        bool buildingPipelines = true;
+
+        // the recording time is reported about once a second, averaged over the frames since the last report
+        auto reportTime = currentTime;
+        double recordTime = 0.0;
+        double maxRecordTime = 0.0;
+        uint32_t recordFrames = 0;
 
 		while (!window.shouldClose()) {
 			glfwPollEvents();
+            residencyManager.beginFrame(); // evicts idle models when over budget and submits the restreams of the last frame
+            modelLoader.update(); // entities get their models as uploads finish, without waiting on the rest
             auto newTime = std::chrono::high_resolution_clock::now();
             float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
             currentTime = newTime;
@@ -61,21 +94,70 @@ namespace ToyBox {
 			if (auto commandBuffer = renderer.beginFrame()) {
                 // prepare and update entities in memory
                 int frameIndex = renderer.getFrameIndex();
-                FrameInfo frameInfo{ frameIndex, frameTime, commandBuffer, camera, globalDescriptorSets[frameIndex], gameEntities };
+                frameRing.beginFrame(frameIndex); // the frame's fence has signalled, so its partition is free again
+                FrameInfo frameInfo{ frameIndex, frameTime, commandBuffer, camera, globalDescriptorSet, gameEntities, renderer.getSwapChainExtent() };
                 GlobalUbo ubo = {};
                 ubo.projection = camera.getProjection();
                 ubo.view = camera.getView();
                 ubo.inverseView = camera.getInverseView();
                 pointLightSys.update(frameInfo, ubo);
-                uboBuffers[frameIndex]->writeToBuffer(&ubo);
-                uboBuffers[frameIndex]->flush();
+                frameInfo.globalUboOffset = frameRing.write(ubo).getDynamicOffset();
+                frameInfo.frameRing = &frameRing;
+                frameInfo.recorder = &renderer.getRecorder();
 
-                // render
+                // render, culling on the gpu first if there's a gpu scene
+                renderSys.cullEntities(frameInfo);
 				renderer.beginSwapChainRenderPass(commandBuffer);
 				renderSys.renderEntities(frameInfo);
                 pointLightSys.render(frameInfo);
 				renderer.endSwapChainRenderPass(commandBuffer);
+                frameRing.flush(); // after recording, so everything written into the ring this frame is visible to the device
 				renderer.endFrame();
+
+                recordTime += renderSys.getRecordTime();
+                maxRecordTime = std::max(maxRecordTime, renderSys.getRecordTime());
+                recordFrames++;
+                if (newTime - reportTime >= std::chrono::seconds(1)) {
+                    std::cout << "recording: " << recordTime / recordFrames << " ms per frame (max " << maxRecordTime << " ms over " << recordFrames << " frames) for "
+                        << renderSys.getInstanceCount() << " entities in " << renderSys.getDrawCount() << " draws, " << renderer.getRecorder().getSecondaryCount()
+                        << " secondary command buffers on " << renderer.getRecorder().getThreadCount() << " threads" << std::endl;
+                    reportTime = newTime;
+                    recordTime = 0.0;
+                    maxRecordTime = 0.0;
+                    recordFrames = 0;
+                }
+
+                if (firstFrame) {
+                    firstFrame = false;
+                    std::cout << "first frame after " << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count() << " ms ("
+                        << device.getUploadBatcher().getSubmittedBatchCount() << " upload batches, " << device.getUploadBatcher().getUploadedBytes() / (1024 * 1024) << " MB, geometry arena "
+                        << device.getGeometryArena().getUsedBytes() / (1024 * 1024) << " of " << device.getGeometryArena().getCapacityBytes() / (1024 * 1024) << " MB in "
+                        << device.getGeometryArena().getPoolCount() << " pools)" << std::endl;
+                    device.getMemoryAllocator().printStats();
+                }
+                if (buildingPipelines && pipelineBuilder.getPendingCount() == 0) {
+                    buildingPipelines = false;
+                    std::cout << "pipelines: " << pipelineBuilder.getBuiltCount() << " built on " << pipelineBuilder.getThreadCount() << " threads in "
+                        << pipelineBuilder.getBuildTime() << " ms (" << pipelineRegistry.getRequestCount() << " requested, " << pipelineRegistry.getDerivativeCount() << " derivative requests, " << pipelineBuilder.getDerivedCount() << " built as derivatives, "
+                        << pipelineRegistry.getLayoutCount() << " layouts)" << std::endl;
+                    device.getPipelineCache().printStats(); // compare startups with a cold and a warm cache
+                }
+                if (loadingModels && modelLoader.getPendingCount() == 0) {
+                    loadingModels = false;
+                    std::cout << "all models resident after " << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count() << " ms ("
+                        << device.getUploadBatcher().getSubmittedBatchCount() << " upload batches, " << device.getUploadBatcher().getUploadedBytes() / (1024 * 1024) << " MB, geometry arena "
+                        << device.getGeometryArena().getUsedBytes() / (1024 * 1024) << " of " << device.getGeometryArena().getCapacityBytes() / (1024 * 1024) << " MB in "
+                        << device.getGeometryArena().getPoolCount() << " pools)" << std::endl;
+                    device.getMemoryAllocator().printStats();
+                    std::cout << "entities: " << renderSys.getInstanceCount() << " drawn with " << renderSys.getDrawCount() << " draw calls (" << renderSys.getVisibleCount() << " visible, "
+                        << renderSys.getCulledCount() << " culled), recorded into " << renderer.getRecorder().getSecondaryCount() << " secondary command buffers on "
+                        << renderer.getRecorder().getThreadCount() << " threads" << std::endl;
+                    const RenderQueue& queue = renderSys.getQueue();
+                    std::cout << "render queue: " << queue.size() << " packets sorted in " << queue.getSortPasses() << " passes, pipeline binds " << queue.getUnsortedStats().pipelineBinds
+                        << " -> " << queue.getSortedStats().pipelineBinds << ", buffer binds " << queue.getUnsortedStats().bufferBinds << " -> " << queue.getSortedStats().bufferBinds
+                        << ", draws " << queue.getUnsortedStats().draws << " -> " << queue.getSortedStats().draws << std::endl;
+                    if (gpuScene) std::cout << "gpu scene: " << gpuScene->getObjectCount() << " objects in " << gpuScene->getBatches().size() << " batches" << std::endl;
+                }
 			}
 		}
 
@@ -83,27 +165,32 @@ namespace ToyBox {
 	}
 
     void Application::loadEntities() {
-        std::shared_ptr<Model> model = Model::createModelFromFile(device, "A:\\Dev\\Libraries\\models\\tree.obj");
+        // models load in the background, each entity renders from the frame after its model becomes resident
+        auto attachModel = [this](Entity::id_t id) {
+            return [this, id](std::shared_ptr<Model> model) {
+                // the entity may have been removed while its model loaded, then the model is simply dropped
+                auto entity = gameEntities.find(id);
+                if (entity == gameEntities.end()) return;
+                if (gpuScene) gpuScene->addObject(id, model, entity->second.transform);
+                entity->second.model = std::move(model);
+            };
+        };
 
         auto tree = Entity::createEntity();
-        tree.model = model;
+        modelLoader.load("A:\\Dev\\Libraries\\models\\tree.obj", Model::VertexFormat::Packed, attachModel(tree.getId()));
         tree.transform.translation = { .0f, 1.0f, 0.f };
         tree.transform.scale = { .05f, .05f, .05f };
         tree.transform.rotation = { .0f, .0f, 3.14f };
         gameEntities.emplace(tree.getId(), std::move(tree));
 
-        model = Model::createModelFromFile(device, "A:\\Dev\\Libraries\\models\\flat_vase.obj");
-        
         auto vase = Entity::createEntity();
-        vase.model = model;
+        modelLoader.load("A:\\Dev\\Libraries\\models\\flat_vase.obj", Model::VertexFormat::Float, attachModel(vase.getId()));
         vase.transform.translation = { .0f, 2.08f, 0.f };
         vase.transform.scale = { 3.f, 3.f, 3.f };
         gameEntities.emplace(vase.getId(), std::move(vase));
 
-        model = Model::createModelFromFile(device, "A:\\Dev\\Libraries\\models\\quad.obj");
-
         auto floor = Entity::createEntity();
-        floor.model = model;
+        modelLoader.load("A:\\Dev\\Libraries\\models\\quad.obj", Model::VertexFormat::Float, attachModel(floor.getId()));
         floor.transform.translation = { .0f, 2.08f, 0.f };
         floor.transform.scale = { 5.f, 5.f, 5.f };
         gameEntities.emplace(floor.getId(), std::move(floor));
@@ -4,6 +4,10 @@
 #include "entity.hpp"
 #include "renderer.hpp"
 #include "descriptors.hpp"
+#include "modelloader.hpp"
+#include "gpuscene.hpp"
+#include "residencymanager.hpp"
+#include <chrono>
 #include <memory>
 #include <vector>
 
@@ -13,7 +17,7 @@ namespace ToyBox {
 		static constexpr int WIDTH = 1920; // window width
 		static constexpr int HEIGHT = 1080; // window height
 
-		Application(); // constructor
+		Application(unsigned int recordThreads = 0); // constructor, 0 record threads means one per hardware thread
 		~Application(); // destructor
 
 		// not copyable or movable
@@ -25,10 +29,14 @@ namespace ToyBox {
 	private:
 		void loadEntities(); // load the entities
 
+		std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now(); // when construction started, for startup timings
 		Window window{ WIDTH, HEIGHT, "VulkanGame" }; // a handle for the window instance
 		Device device{ window }; // a handle for the device instance
 		Entity::Map gameEntities; // a handle for the entity objects
 		std::unique_ptr<DescriptorPool> globalPool = {}; // a handle for the descriptor pool
 		Renderer renderer{ window, device }; // a handle for the renderer
+		ResidencyManager residencyManager{ device }; // a handle for the residency manager, keeping model geometry within the memory budget
+		ModelLoader modelLoader{ device }; // a handle for the background model loader
+		std::unique_ptr<GpuScene> gpuScene = {}; // a handle for the gpu-driven scene, only when the device supports indirect count draws
 	};
 }
\ No newline at end of file
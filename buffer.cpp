@@ -40,33 +40,37 @@ namespace ToyBox {
     Buffer::~Buffer() {
         unmap();
         vkDestroyBuffer(device.getDevice(), buffer, nullptr);
-        vkFreeMemory(device.getDevice(), memory, nullptr);
+        device.freeMemory(memory);
     }
 
     /**
      * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
      *
-     * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
-     * buffer range.
+     * @note Host visible memory blocks stay mapped for their whole life, so this only points mapped into the block,
+     * the size is only checked against the buffer
+     *
+     * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map from offset to the
+     * end of the buffer.
      * @param offset (Optional) Byte offset from beginning
      *
-     * @return VkResult of the buffer mapping call
+     * @return VkResult of the buffer mapping call, VK_ERROR_MEMORY_MAP_FAILED if the range is outside the buffer
      */
     VkResult Buffer::map(VkDeviceSize size, VkDeviceSize offset) {
-        assert(buffer && memory && "Called map on buffer before create");
-        return vkMapMemory(device.getDevice(), memory, offset, size, 0, &mapped);
+        assert(buffer && memory.isValid() && "Called map on buffer before create");
+        if (!memory.mapped || offset > bufferSize || (size != VK_WHOLE_SIZE && size > bufferSize - offset)) {
+            return VK_ERROR_MEMORY_MAP_FAILED;
+        }
+        mapped = static_cast<char*>(memory.mapped) + offset;
+        return VK_SUCCESS;
     }
 
     /**
-     * Unmap a mapped memory range
+     * Unmap a memory range
      *
-     * @note Does not return a result as vkUnmapMemory can't fail
+     * @note Does not return a result as unmapping can't fail, the block itself stays mapped
      */
     void Buffer::unmap() {
-        if (mapped) {
-            vkUnmapMemory(device.getDevice(), memory);
-            mapped = nullptr;
-        }
+        mapped = nullptr;
     }
 
     /**
@@ -103,12 +107,7 @@ namespace ToyBox {
      * @return VkResult of the flush call
      */
     VkResult Buffer::flush(VkDeviceSize size, VkDeviceSize offset) {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
-        return vkFlushMappedMemoryRanges(device.getDevice(), 1, &mappedRange);
+        return device.getMemoryAllocator().flush(memory, offset, size);
     }
 
     /**
@@ -123,12 +122,7 @@ namespace ToyBox {
      * @return VkResult of the invalidate call
      */
     VkResult Buffer::invalidate(VkDeviceSize size, VkDeviceSize offset) {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
-        return vkInvalidateMappedMemoryRanges(device.getDevice(), 1, &mappedRange);
+        return device.getMemoryAllocator().invalidate(memory, offset, size);
     }
 
     /**
@@ -44,7 +44,7 @@ namespace ToyBox {
         Device& device;
         void* mapped = nullptr;
         VkBuffer buffer = VK_NULL_HANDLE;
-        VkDeviceMemory memory = VK_NULL_HANDLE;
+        MemoryAllocation memory = {};
 
         VkDeviceSize bufferSize;
         uint32_t instanceCount;
@@ -1,6 +1,10 @@
 #include "camera.hpp"
 #include <cassert>
 #include <limits>
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define TOYBOX_SSE
+#include <xmmintrin.h>
+#endif
 
 namespace ToyBox {
 	void Camera::setOrthographicProjection(float left, float right, float top, float bottom, float near, float far) {
@@ -102,4 +106,73 @@ namespace ToyBox {
 		inverseViewMatrix[3][1] = position.y;
 		inverseViewMatrix[3][2] = position.z;
 	}
+
+	Frustum Camera::getFrustum() const {
+		// Gribb and Hartmann: every plane is a sum or difference of rows of the combined matrix (depth runs from 0 to 1)
+		const glm::mat4 m = projectionMatrix * viewMatrix;
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; i++) {
+			rows[i] = glm::vec4{ m[0][i], m[1][i], m[2][i], m[3][i] };
+		}
+
+		Frustum frustum = {};
+		frustum.planes[0] = rows[3] + rows[0];
+		frustum.planes[1] = rows[3] - rows[0];
+		frustum.planes[2] = rows[3] + rows[1];
+		frustum.planes[3] = rows[3] - rows[1];
+		frustum.planes[4] = rows[2];
+		frustum.planes[5] = rows[3] - rows[2];
+		for (auto& plane : frustum.planes) {
+			plane /= glm::length(glm::vec3(plane));
+		}
+		return frustum;
+	}
+
+	bool Frustum::intersectsSphere(const glm::vec3& center, float radius) const {
+		for (const auto& plane : planes) {
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) return false;
+		}
+		return true;
+	}
+
+	void Frustum::intersectSpheres(const SphereList& spheres, std::vector<uint8_t>& visible) const {
+		const size_t count = spheres.size();
+		visible.resize(count);
+		size_t i = 0;
+
+#ifdef TOYBOX_SSE
+		// each plane is broadcast to all four lanes, and every lane tests its own sphere against it
+		__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+		for (int p = 0; p < 6; p++) {
+			planeX[p] = _mm_set1_ps(planes[p].x);
+			planeY[p] = _mm_set1_ps(planes[p].y);
+			planeZ[p] = _mm_set1_ps(planes[p].z);
+			planeW[p] = _mm_set1_ps(planes[p].w);
+		}
+
+		for (; i + 4 <= count; i += 4) {
+			const __m128 x = _mm_loadu_ps(spheres.x.data() + i);
+			const __m128 y = _mm_loadu_ps(spheres.y.data() + i);
+			const __m128 z = _mm_loadu_ps(spheres.z.data() + i);
+			const __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(spheres.radius.data() + i));
+
+			// a sphere is outside once it's fully behind any plane, same as intersectsSphere
+			__m128 outside = _mm_setzero_ps();
+			for (int p = 0; p < 6; p++) {
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, planeX[p]), _mm_mul_ps(y, planeY[p])), _mm_add_ps(_mm_mul_ps(z, planeZ[p]), planeW[p]));
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+			}
+
+			int outsideMask = _mm_movemask_ps(outside);
+			for (int lane = 0; lane < 4; lane++) {
+				visible[i + lane] = (outsideMask >> lane & 1) ? 0 : 1;
+			}
+		}
+#endif
+
+		// the remainder, or everything without SSE
+		for (; i < count; i++) {
+			visible[i] = intersectsSphere({ spheres.x[i], spheres.y[i], spheres.z[i] }, spheres.radius[i]) ? 1 : 0;
+		}
+	}
 }
\ No newline at end of file
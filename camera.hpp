@@ -2,8 +2,42 @@
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
 
 namespace ToyBox {
+	// bounding spheres kept as one array per component, so Frustum::intersectSpheres can load several of them at once
+	struct SphereList {
+		std::vector<float> x = {};
+		std::vector<float> y = {};
+		std::vector<float> z = {};
+		std::vector<float> radius = {};
+
+		void add(const glm::vec3& center, float sphereRadius) {
+			x.push_back(center.x);
+			y.push_back(center.y);
+			z.push_back(center.z);
+			radius.push_back(sphereRadius);
+		}
+		void set(size_t index, const glm::vec3& center, float sphereRadius) { // for filling a resized list from several threads
+			x[index] = center.x;
+			y[index] = center.y;
+			z[index] = center.z;
+			radius[index] = sphereRadius;
+		}
+		void resize(size_t count) { x.resize(count); y.resize(count); z.resize(count); radius.resize(count); }
+		void clear() { x.clear(); y.clear(); z.clear(); radius.clear(); }
+		size_t size() const { return radius.size(); }
+	};
+
+	// six world space planes (xyz is the inward facing normal, w the offset) bounding what a camera can see
+	struct Frustum {
+		glm::vec4 planes[6] = {}; // left, right, bottom, top, near, far
+
+		bool intersectsSphere(const glm::vec3& center, float radius) const; // conservative, may accept spheres just outside a corner
+		void intersectSpheres(const SphereList& spheres, std::vector<uint8_t>& visible) const; // intersectsSphere for every sphere, four at a time with SSE, 1 in visible for each one that passes
+	};
+
 	class Camera {
 	public:
 		void setOrthographicProjection(float left, float right, float top, float bottom, float near, float far); // to define each plane of the orthographic viewing volume
@@ -18,6 +52,8 @@ namespace ToyBox {
 		const glm::mat4& getProjection() const { return projectionMatrix; }
 		const glm::mat4& getView() const { return viewMatrix; }
 		const glm::mat4& getInverseView() const { return inverseViewMatrix; }
+		glm::vec3 getPosition() const { return glm::vec3(inverseViewMatrix[3]); }
+		Frustum getFrustum() const; // extract the frustum planes from the projection and view matrices
 
 	private:
 		glm::mat4 projectionMatrix{ 1.f };
@@ -1,4 +1,8 @@
 #include "device.hpp"
+#include "uploadbatcher.hpp"
+#include "geometryarena.hpp"
+#include "pipelinecache.hpp"
+#include "queuetimeline.hpp"
 #include <cstring>
 #include <iostream>
 #include <set>
@@ -42,10 +46,20 @@ namespace ToyBox {
 		createSurface();
 		pickPhysicalDevice();
 		createLogicalDevice();
+		memoryAllocator = std::make_unique<MemoryAllocator>(physicalDevice, device_);
+		pipelineCache = std::make_unique<PipelineCache>(device_, deviceProperties);
 		createCommandPool();
+		uploadBatcher = std::make_unique<UploadBatcher>(*this);
+		geometryArena = std::make_unique<GeometryArena>(*this);
 	}
 
 	Device::~Device() {
+		uploadBatcher.reset(); // waits for outstanding uploads and frees the staging ring while the device still exists
+		geometryArena.reset();
+		memoryAllocator.reset();
+		pipelineCache.reset(); // writes the cache back to disk
+		transferTimeline.reset(); // waits for the last submissions on each queue
+		graphicsTimeline.reset();
 		vkDestroyCommandPool(device_, commandPool, nullptr);
 		vkDestroyDevice(device_, nullptr);
 
@@ -69,7 +83,7 @@ namespace ToyBox {
 		appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 		appInfo.pEngineName = "No Engine";
 		appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-		appInfo.apiVersion = VK_API_VERSION_1_0;
+		appInfo.apiVersion = VK_API_VERSION_1_2; // timeline semaphores are core from 1.2
 
 		// specify global extensions and validation layers to Vulkan driver
 		VkInstanceCreateInfo createInfo = {};
@@ -134,7 +148,7 @@ namespace ToyBox {
 		// we need multiple VkDeviceQueueCreateInfo structs to create a queue from graphics/present families
 		// so create a set of all unique queue families necessary for required queues
 		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-		std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily };
+		std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily, indices.transferFamily };
 
 		// specify the queries to be created
 		float queuePriority = 1.0f;
@@ -147,9 +161,24 @@ namespace ToyBox {
 			queueCreateInfos.push_back(queueCreateInfo);
 		}
 
+		// gpu-driven rendering is optional, it needs draw counts read from a buffer and a first instance in indirect draws
+		VkPhysicalDeviceVulkan12Features supported12 = {};
+		supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		VkPhysicalDeviceFeatures2 supportedFeatures = {};
+		supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supportedFeatures.pNext = &supported12;
+		vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures);
+		drawIndirectCountSupported = supported12.drawIndirectCount && supportedFeatures.features.multiDrawIndirect && supportedFeatures.features.drawIndirectFirstInstance;
+
 		// specify used device features
 		VkPhysicalDeviceFeatures deviceFeatures = {};
 		deviceFeatures.samplerAnisotropy = VK_TRUE;
+		deviceFeatures.multiDrawIndirect = drawIndirectCountSupported;
+		deviceFeatures.drawIndirectFirstInstance = drawIndirectCountSupported;
+		VkPhysicalDeviceVulkan12Features features12 = {};
+		features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		features12.timelineSemaphore = VK_TRUE;
+		features12.drawIndirectCount = drawIndirectCountSupported;
 
 		// create the logical device
 		VkDeviceCreateInfo createInfo = {};
@@ -157,8 +186,16 @@ namespace ToyBox {
 		createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 		createInfo.pQueueCreateInfos = queueCreateInfos.data();
 		createInfo.pEnabledFeatures = &deviceFeatures;
-		createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-		createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+		createInfo.pNext = &features12;
+
+		// the memory budget extension is optional, without it budgets are estimated from the heap sizes
+		std::vector<const char*> enabledExtensions = deviceExtensions;
+		if (properties2Supported && isDeviceExtensionAvailable(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+			enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+			memoryBudgetSupported = true;
+		}
+		createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+		createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 		
 		// enabledLayerCount and ppEnabledLayerNames fields of VkDeviceCreateInfo are ignored by up-to-date implementations
 		// but it's a good idea to set them up anyway to be compatible with older implementations
@@ -178,6 +215,12 @@ namespace ToyBox {
 		// retrieve queue handles for each queue family
 		vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
 		vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+		vkGetDeviceQueue(device_, indices.transferFamily, 0, &transferQueue_);
+		graphicsTimeline = std::make_unique<QueueTimeline>(device_, graphicsQueue_);
+		if (indices.dedicatedTransferFamily) {
+			transferTimeline = std::make_unique<QueueTimeline>(device_, transferQueue_);
+		}
+		std::cout << "transfer queue: " << (indices.dedicatedTransferFamily ? "dedicated family " : "shared with graphics, family ") << indices.transferFamily << std::endl;
 	}
 
 	void Device::createCommandPool() {
@@ -210,7 +253,21 @@ namespace ToyBox {
 		VkPhysicalDeviceFeatures supportedFeatures;
 		vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
-		return indices.isComplete() && extensionsSupported && swapchainAdequate && supportedFeatures.samplerAnisotropy;
+		// every queue submission is tracked with a timeline semaphore, which needs a 1.2 device
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(device, &properties);
+		bool timelineSupported = false;
+		if (properties.apiVersion >= VK_API_VERSION_1_2) {
+			VkPhysicalDeviceVulkan12Features features12 = {};
+			features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+			VkPhysicalDeviceFeatures2 features2 = {};
+			features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			features2.pNext = &features12;
+			vkGetPhysicalDeviceFeatures2(device, &features2);
+			timelineSupported = features12.timelineSemaphore;
+		}
+
+		return indices.isComplete() && extensionsSupported && swapchainAdequate && supportedFeatures.samplerAnisotropy && timelineSupported;
 	}
 
 	void Device::populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo) {
@@ -267,6 +324,12 @@ namespace ToyBox {
 
 		if (enableValidationLayers) { extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME); }
 
+		// optional, needed to query VK_EXT_memory_budget
+		if (isInstanceExtensionAvailable(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)) {
+			extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+			properties2Supported = true;
+		}
+
 		return extensions;
 	}
 
@@ -310,6 +373,30 @@ namespace ToyBox {
 		return requiredExtensions.empty();
 	}
 
+	bool Device::isInstanceExtensionAvailable(const char* extensionName) {
+		uint32_t extensionCount = 0;
+		vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+		std::vector<VkExtensionProperties> extensions(extensionCount);
+		vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+
+		for (const auto& extension : extensions) {
+			if (strcmp(extension.extensionName, extensionName) == 0) return true;
+		}
+		return false;
+	}
+
+	bool Device::isDeviceExtensionAvailable(VkPhysicalDevice device, const char* extensionName) {
+		uint32_t extensionCount = 0;
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+		std::vector<VkExtensionProperties> extensions(extensionCount);
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+
+		for (const auto& extension : extensions) {
+			if (strcmp(extension.extensionName, extensionName) == 0) return true;
+		}
+		return false;
+	}
+
 	QueueFamilyIndices Device::findQueueFamilies(VkPhysicalDevice device) {
 		QueueFamilyIndices indices;
 
@@ -320,28 +407,41 @@ namespace ToyBox {
 
 		int i = 0;
 		for (const auto& queueFamily : queueFamilies) { 
-			// find at least one queue family that supports VK_QUEUE_GRAPHICS_BIT
-			if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-				indices.graphicsFamily = i;
-				indices.graphicsFamilyHasValue = true;
-			}
+			// stop updating graphics/present once we've found what we need, but keep looking for a transfer family
+			if (!indices.isComplete()) {
+				// find at least one queue family that supports VK_QUEUE_GRAPHICS_BIT
+				if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+					indices.graphicsFamily = i;
+					indices.graphicsFamilyHasValue = true;
+				}
 
-			// look for a queue family that has the capability of presenting to the window surface
-			VkBool32 presentSupport = false;
-			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
-			if (queueFamily.queueCount > 0 && presentSupport) {
-				indices.presentFamily = i;
-				indices.presentFamilyHasValue = true;
+				// look for a queue family that has the capability of presenting to the window surface
+				VkBool32 presentSupport = false;
+				vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+				if (queueFamily.queueCount > 0 && presentSupport) {
+					indices.presentFamily = i;
+					indices.presentFamilyHasValue = true;
+				}
 			}
 
-			// exit early if we've found what we need
-			if (indices.isComplete()) { 
-				break;
+			// prefer a family that can only transfer (the copy engines), then any transfer family without graphics
+			if (queueFamily.queueCount > 0 && (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+				// a transfer-only family replaces an async compute family found earlier
+				bool transferOnly = !(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT);
+				if (!indices.dedicatedTransferFamily || (transferOnly && (queueFamilies[indices.transferFamily].queueFlags & VK_QUEUE_COMPUTE_BIT))) {
+					indices.transferFamily = i;
+					indices.dedicatedTransferFamily = true;
+				}
 			}
 
 			i++;
 		}
 
+		// graphics queues can always transfer, so they take the copies when there is nothing dedicated
+		if (!indices.dedicatedTransferFamily) {
+			indices.transferFamily = indices.graphicsFamily;
+		}
+
 		return indices;
 	}
 
@@ -400,7 +500,43 @@ namespace ToyBox {
 		throw std::runtime_error("failed to find suitable memory type!");
 	}
 
-	void Device::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+	VkPhysicalDeviceMemoryProperties Device::getMemoryProperties() {
+		VkPhysicalDeviceMemoryProperties memProperties;
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+		return memProperties;
+	}
+
+	void Device::getMemoryBudget(std::vector<VkDeviceSize>& heapBudgets, std::vector<VkDeviceSize>& heapUsages) {
+		VkPhysicalDeviceMemoryProperties memProperties = getMemoryProperties();
+		heapBudgets.assign(memProperties.memoryHeapCount, 0);
+		heapUsages.assign(memProperties.memoryHeapCount, 0);
+
+		// the budget covers every process on the system and changes over time, so it's queried fresh each time
+		if (memoryBudgetSupported) {
+			auto getMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(vulkan, "vkGetPhysicalDeviceMemoryProperties2KHR");
+			if (getMemoryProperties2 != nullptr) {
+				VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+				budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+				VkPhysicalDeviceMemoryProperties2 memProperties2 = {};
+				memProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+				memProperties2.pNext = &budgetProperties;
+				getMemoryProperties2(physicalDevice, &memProperties2);
+
+				for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++) {
+					heapBudgets[i] = budgetProperties.heapBudget[i];
+					heapUsages[i] = budgetProperties.heapUsage[i];
+				}
+				return;
+			}
+		}
+
+		for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++) {
+			heapBudgets[i] = memProperties.memoryHeaps[i].size / 10 * 8;
+			heapUsages[i] = memoryAllocator->getHeapUsage(i);
+		}
+	}
+
+	void Device::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, MemoryAllocation& bufferMemory) {
 		VkBufferCreateInfo bufferInfo = {};
 		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 		bufferInfo.size = size;
@@ -414,18 +550,11 @@ namespace ToyBox {
 		VkMemoryRequirements memRequirements;
 		vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
 
-		// allocate the vertex buffer memory
-		VkMemoryAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-		if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-			throw std::runtime_error("failed to allocate vertex buffer memory!");
-		}
+		// suballocate the buffer memory out of a shared block
+		bufferMemory = memoryAllocator->allocate(memRequirements, properties, true);
 
 		// associate the allocated memory with the buffer
-		vkBindBufferMemory(device_, buffer, bufferMemory, 0);
+		vkBindBufferMemory(device_, buffer, bufferMemory.memory, bufferMemory.offset);
 	}
 
 	VkCommandBuffer Device::beginSingleTimeCommands() {
@@ -450,13 +579,8 @@ namespace ToyBox {
 		// stop recording the command buffer
 		vkEndCommandBuffer(commandBuffer);
 
-		// execute the command buffer
-		VkSubmitInfo submitInfo = {};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &commandBuffer;
-		vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-		vkQueueWaitIdle(graphicsQueue_);
+		// execute the command buffer and wait for this submission only, instead of draining the queue
+		graphicsTimeline->wait(graphicsTimeline->submit(1, &commandBuffer));
 
 		// clean up the command buffer
 		vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
@@ -496,7 +620,7 @@ namespace ToyBox {
 		endSingleTimeCommands(commandBuffer);
 	}
 
-	void Device::createImageWithInfo(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
+	void Device::createImageWithInfo(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image, MemoryAllocation& imageMemory) {
 		if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create image!");
 		}
@@ -504,16 +628,10 @@ namespace ToyBox {
 		VkMemoryRequirements memRequirements;
 		vkGetImageMemoryRequirements(device_, image, &memRequirements);
 
-		VkMemoryAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-		if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-			throw std::runtime_error("failed to allocate image memory!");
-		}
+		// optimal tiling images come from their own blocks, so they never share a bufferImageGranularity page with a buffer
+		imageMemory = memoryAllocator->allocate(memRequirements, properties, imageInfo.tiling == VK_IMAGE_TILING_LINEAR);
 
-		if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) {
+		if (vkBindImageMemory(device_, image, imageMemory.memory, imageMemory.offset) != VK_SUCCESS) {
 			throw std::runtime_error("failed to bind image memory!");
 		}
 	}
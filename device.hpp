@@ -1,10 +1,17 @@
 #pragma once
 #include "window.hpp"
+#include "memoryallocator.hpp"
+#include <memory>
 #include <string>
 #include <vector>
 #include <optional>
 
 namespace ToyBox {
+	class GeometryArena;
+	class PipelineCache;
+	class QueueTimeline;
+	class UploadBatcher;
+
 	// struct for checking surface capabilities, surface formats, and available presentation modes for the swap chain
 	struct SwapChainSupportDetails {
 		VkSurfaceCapabilitiesKHR capabilities;
@@ -16,8 +23,10 @@ namespace ToyBox {
 	struct QueueFamilyIndices {
 		uint32_t graphicsFamily; // could use std::optional for this, but will need some refactoring with current implementation
 		uint32_t presentFamily; // same as above with std::optional
+		uint32_t transferFamily; // a transfer-only family when the device has one, otherwise the graphics family
 		bool graphicsFamilyHasValue = false;
 		bool presentFamilyHasValue = false;
+		bool dedicatedTransferFamily = false; // whether transferFamily differs from graphicsFamily, so copies run beside rendering
 		bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
 	};
 
@@ -43,18 +52,33 @@ namespace ToyBox {
 		VkSurfaceKHR getSurface() { return surface_; }
 		VkQueue getGraphicsQueue() { return graphicsQueue_; }
 		VkQueue getPresentQueue() { return presentQueue_; }
+		VkQueue getTransferQueue() { return transferQueue_; } // the graphics queue when there is no dedicated transfer family
+		QueueTimeline& getGraphicsTimeline() { return *graphicsTimeline; } // every submission to the graphics queue goes through here
+		QueueTimeline& getTransferTimeline() { return transferTimeline ? *transferTimeline : *graphicsTimeline; } // the graphics timeline when the queues are shared
+		UploadBatcher& getUploadBatcher() { return *uploadBatcher; } // batched staging uploads for device-local buffers
+		GeometryArena& getGeometryArena() { return *geometryArena; } // shared vertex and index buffers every model is suballocated from
+		MemoryAllocator& getMemoryAllocator() { return *memoryAllocator; } // device memory for every buffer and image
+		PipelineCache& getPipelineCache() { return *pipelineCache; } // shared by every pipeline and kept on disk between runs
 
 		SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); } // get swap chain support details for the physical device
 		uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties); // find the right type of memory to use based on the vertex buffer and our own app requirements
 		QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice); } // look for all the queue families we need
 		VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
-		void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory); // initialize and return a buffer
+		void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, MemoryAllocation& bufferMemory); // initialize and return a buffer
 		VkCommandBuffer beginSingleTimeCommands();
 		void endSingleTimeCommands(VkCommandBuffer commandBuffer);
 		void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
 		void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
-		void createImageWithInfo(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
+		void createImageWithInfo(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image, MemoryAllocation& imageMemory);
+		void freeMemory(MemoryAllocation& memory) { memoryAllocator->free(memory); } // release the memory of a destroyed buffer or image
+
+		// budget and current usage of every memory heap, from VK_EXT_memory_budget when the device has it,
+		// otherwise 80% of the heap size and the bytes the memory allocator holds in it
+		void getMemoryBudget(std::vector<VkDeviceSize>& heapBudgets, std::vector<VkDeviceSize>& heapUsages);
+		bool isMemoryBudgetSupported() const { return memoryBudgetSupported; }
+		bool isDrawIndirectCountSupported() const { return drawIndirectCountSupported; } // whether gpu-driven rendering with vkCmdDrawIndexedIndirectCount can be used
+		VkPhysicalDeviceMemoryProperties getMemoryProperties(); // memory types and heaps of the physical device
 		VkPhysicalDeviceProperties deviceProperties;
 
 	private:
@@ -72,6 +96,8 @@ namespace ToyBox {
 		void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo); // fills in a structure with debug messenger and callback details
 		void hasGlfwRequiredInstanceExtensions(); // check if required GLFW extensions are present
 		bool checkDeviceExtensionSupport(VkPhysicalDevice device); // called from isDeviceSuitable as an additonal check
+		bool isInstanceExtensionAvailable(const char* extensionName); // for optional instance extensions
+		bool isDeviceExtensionAvailable(VkPhysicalDevice device, const char* extensionName); // for optional device extensions
 		SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device); // to populate the SwapChainSupportDetails struct
 
 		VkInstance vulkan; // data member to handle Vulkan instance
@@ -84,8 +110,18 @@ namespace ToyBox {
 		VkSurfaceKHR surface_; // a handle to store the surface to present rendered images to
 		VkQueue graphicsQueue_; // a handle to store the graphics queue
 		VkQueue presentQueue_; // a handle to store the presentation queue
+		VkQueue transferQueue_; // a handle to store the transfer queue
+		std::unique_ptr<QueueTimeline> graphicsTimeline; // a handle to store the graphics queue timeline
+		std::unique_ptr<QueueTimeline> transferTimeline; // a handle to store the transfer queue timeline, only with a dedicated transfer family
+		std::unique_ptr<UploadBatcher> uploadBatcher; // a handle to store the upload batcher, destroyed before the device
+		std::unique_ptr<GeometryArena> geometryArena; // a handle to store the geometry arena, destroyed after the uploads into it have finished
+		std::unique_ptr<MemoryAllocator> memoryAllocator; // a handle to store the memory allocator, destroyed after every buffer and image
+		std::unique_ptr<PipelineCache> pipelineCache; // a handle to store the pipeline cache, saved to disk when destroyed
 
 		const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation" }; // standard validation is bundled into this layer included in the SDK
 		const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME }; // list of required device extensions
+		bool properties2Supported = false; // a flag for VK_KHR_get_physical_device_properties2 being enabled on the instance
+		bool memoryBudgetSupported = false; // a flag for VK_EXT_memory_budget being enabled on the device
+		bool drawIndirectCountSupported = false; // a flag for drawIndirectCount, multiDrawIndirect and drawIndirectFirstInstance being enabled on the device
 	};
 }
\ No newline at end of file
@@ -1,10 +1,12 @@
 #pragma once
 #include "camera.hpp"
 #include "entity.hpp"
+#include "frameringbuffer.hpp"
+#include "parallelrecorder.hpp"
 #include <vulkan/vulkan.h>
 
 namespace ToyBox {
-#define MAX_LIGHTS 10
+#define MAX_LIGHTS 10 // also defined in global_ubo.glsl, which the shaders include
 	struct PointLight {
 		glm::vec4 position = {};
 		glm::vec4 color = {};
@@ -28,5 +30,10 @@ namespace ToyBox {
 		Camera& camera;
 		VkDescriptorSet globalDescriptorSet;
 		Entity::Map& gameEntities;
+		VkExtent2D extent = {}; // size of the swap chain images, for anything measured in pixels
+		uint32_t globalUboOffset = 0; // dynamic offset of this frame's global ubo in the frame ring buffer
+		FrameRingBuffer* frameRing = nullptr; // this frame's partition of the ring buffer, for the global ubo, the gpu scene's uploads and other per-frame writes
+		int lightCount = 0; // point lights in this frame's global ubo, for picking shader variants
+		ParallelRecorder* recorder = nullptr; // records the render pass's draws into secondary command buffers on worker threads
 	};
 }
\ No newline at end of file
@@ -0,0 +1,44 @@
+#include "frameringbuffer.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace ToyBox {
+	FrameRingBuffer::FrameRingBuffer(Device& device, VkDeviceSize frameSize, int frameCount) : device{ device } {
+		// every allocation may be bound as a uniform or storage buffer at a dynamic offset, and flushed on its own
+		const VkPhysicalDeviceLimits& limits = device.deviceProperties.limits;
+		alignment = std::max({ limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment, limits.nonCoherentAtomSize, VkDeviceSize(16) });
+		this->frameSize = (frameSize + alignment - 1) / alignment * alignment;
+
+		VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+		buffer = std::make_unique<Buffer>(device, this->frameSize, static_cast<uint32_t>(frameCount), usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+		if (buffer->map() != VK_SUCCESS) {
+			throw std::runtime_error("failed to map frame ring buffer!");
+		}
+		mapped = static_cast<char*>(buffer->getMappedMemory());
+	}
+
+	FrameRingBuffer::~FrameRingBuffer() {}
+
+	void FrameRingBuffer::beginFrame(int frameIndex) {
+		frameStart = static_cast<VkDeviceSize>(frameIndex) * frameSize;
+		head = frameStart;
+	}
+
+	FrameRingBuffer::Allocation FrameRingBuffer::allocate(VkDeviceSize size) {
+		VkDeviceSize alignedSize = (size + alignment - 1) / alignment * alignment;
+		if (head + alignedSize > frameStart + frameSize) {
+			throw std::runtime_error("frame ring buffer partition is full!");
+		}
+
+		Allocation allocation = {};
+		allocation.mapped = mapped + head;
+		allocation.offset = head;
+		allocation.size = size;
+		head += alignedSize;
+		return allocation;
+	}
+
+	void FrameRingBuffer::flush() {
+		if (head > frameStart) buffer->flush(head - frameStart, frameStart);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+#include "buffer.hpp"
+#include "swapchain.hpp"
+#include <cstring>
+#include <memory>
+
+namespace ToyBox {
+	// one persistently mapped buffer split into a partition per frame in flight, handing out aligned ranges with a linear allocator.
+	// a partition is reused once beginFrame is called for its frame again, which the renderer only does after that frame's fence
+	// signalled, so per-frame constants, uploads and transient vertices can all be written without extra buffers or waits
+	class FrameRingBuffer {
+	public:
+		static constexpr VkDeviceSize DEFAULT_FRAME_SIZE = 4 * 1024 * 1024; // bytes per frame partition
+
+		// a range in the current frame's partition
+		struct Allocation {
+			void* mapped = nullptr; // where to write the data
+			VkDeviceSize offset = 0; // from the start of the buffer, for vertex/index binds and descriptor writes
+			VkDeviceSize size = 0;
+
+			uint32_t getDynamicOffset() const { return static_cast<uint32_t>(offset); } // for descriptors of a dynamic type
+		};
+
+		FrameRingBuffer(Device& device, VkDeviceSize frameSize = DEFAULT_FRAME_SIZE, int frameCount = SwapChain::MAX_FRAMES_IN_FLIGHT); // constructor
+		~FrameRingBuffer(); // destructor
+
+		// not copyable or movable
+		FrameRingBuffer(const FrameRingBuffer&) = delete;
+		FrameRingBuffer& operator = (const FrameRingBuffer&) = delete;
+
+		void beginFrame(int frameIndex); // start handing out the frame's partition from its beginning, after the frame's fence has signalled
+		Allocation allocate(VkDeviceSize size); // reserve size bytes aligned for any use of the buffer
+		void flush(); // make everything written this frame visible to the device, only does work on non-coherent memory
+
+		// copy a value into a new allocation
+		template <typename T>
+		Allocation write(const T& value) {
+			Allocation allocation = allocate(sizeof(T));
+			std::memcpy(allocation.mapped, &value, sizeof(T));
+			return allocation;
+		}
+
+		VkBuffer getBuffer() const { return buffer->getBuffer(); }
+		VkDescriptorBufferInfo descriptorInfo(VkDeviceSize range) const { return { buffer->getBuffer(), 0, range }; } // for a dynamic descriptor, the offset comes at bind time
+		VkDeviceSize getFrameSize() const { return frameSize; }
+		VkDeviceSize getUsedBytes() const { return head - frameStart; } // bytes handed out this frame
+		VkDeviceSize getFreeBytes() const { return frameStart + frameSize - head; } // bytes left this frame, before the padding of the next allocation
+		VkDeviceSize getAlignment() const { return alignment; } // every allocation is padded up to a multiple of it
+
+	private:
+		Device& device; // a handle for the device instance
+		std::unique_ptr<Buffer> buffer; // a handle for the mapped buffer holding every partition
+		char* mapped = nullptr; // a handle for the mapped memory
+		VkDeviceSize frameSize; // a handle for the size of a partition
+		VkDeviceSize alignment = 1; // a handle for the alignment of every allocation
+		VkDeviceSize frameStart = 0; // a handle for the start of the current partition
+		VkDeviceSize head = 0; // a handle for the next free byte of the current partition
+	};
+}
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include "geometryarena.hpp"
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <iterator>
+
+namespace ToyBox {
+	GeometryArena::GeometryArena(Device& device, VkDeviceSize vertexPoolSize, VkDeviceSize indexPoolSize) : device{ device }, vertexPoolSize{ vertexPoolSize }, indexPoolSize{ indexPoolSize } {}
+
+	GeometryArena::~GeometryArena() {}
+
+	GeometryArena::Allocation GeometryArena::allocateVertices(uint32_t vertexSize, uint32_t count) {
+		return allocate(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, vertexSize, count, vertexPoolSize);
+	}
+
+	GeometryArena::Allocation GeometryArena::allocateIndices(VkIndexType indexType, uint32_t count) {
+		uint32_t indexSize = indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+		return allocate(VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, indexSize, count, indexPoolSize);
+	}
+
+	void GeometryArena::free(Allocation& allocation) {
+		if (!allocation.isValid()) return;
+		Pool& pool = pools[allocation.pool];
+		pool.used -= allocation.count;
+
+		// insert the range and merge it with the free neighbours on either side
+		uint32_t first = allocation.first;
+		uint32_t count = allocation.count;
+		auto next = pool.freeRanges.lower_bound(first);
+		if (next != pool.freeRanges.begin()) {
+			auto previous = std::prev(next);
+			assert(previous->first + previous->second <= first && "Geometry range freed twice");
+			if (previous->first + previous->second == first) {
+				first = previous->first;
+				count += previous->second;
+				pool.freeRanges.erase(previous);
+			}
+		}
+		if (next != pool.freeRanges.end() && first + count == next->first) {
+			count += next->second;
+			pool.freeRanges.erase(next);
+		}
+		pool.freeRanges[first] = count;
+
+		allocation = {};
+	}
+
+	VkBuffer GeometryArena::getBuffer(uint32_t pool) const {
+		return pools[pool].buffer->getBuffer();
+	}
+
+	VkDeviceSize GeometryArena::getUsedBytes() const {
+		VkDeviceSize bytes = 0;
+		for (const auto& pool : pools) bytes += static_cast<VkDeviceSize>(pool.used) * pool.elementSize;
+		return bytes;
+	}
+
+	VkDeviceSize GeometryArena::getCapacityBytes() const {
+		VkDeviceSize bytes = 0;
+		for (const auto& pool : pools) bytes += static_cast<VkDeviceSize>(pool.capacity) * pool.elementSize;
+		return bytes;
+	}
+
+	GeometryArena::Allocation GeometryArena::allocate(VkBufferUsageFlags usage, uint32_t elementSize, uint32_t count, VkDeviceSize poolSize) {
+		assert(count > 0 && "Cannot allocate an empty geometry range");
+
+		Allocation allocation = {};
+		allocation.count = count;
+		for (uint32_t i = 0; i < pools.size(); i++) {
+			if (pools[i].usage != usage || pools[i].elementSize != elementSize) continue;
+			if (allocateFromPool(pools[i], count, allocation.first)) {
+				allocation.pool = i;
+				return allocation;
+			}
+		}
+
+		// every matching pool is full, so add one, big enough for meshes larger than the usual pool size
+		Pool pool = {};
+		pool.usage = usage;
+		pool.elementSize = elementSize;
+		pool.capacity = static_cast<uint32_t>(std::max<VkDeviceSize>(poolSize / elementSize, count));
+		pool.buffer = std::make_unique<Buffer>(device, elementSize, pool.capacity, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		pool.freeRanges[0] = pool.capacity;
+		std::cout << "geometry arena: new pool " << pools.size() << " of " << pool.capacity << " x " << elementSize << " bytes" << std::endl;
+
+		pools.push_back(std::move(pool));
+		allocation.pool = static_cast<uint32_t>(pools.size() - 1);
+		allocateFromPool(pools.back(), count, allocation.first);
+		return allocation;
+	}
+
+	bool GeometryArena::allocateFromPool(Pool& pool, uint32_t count, uint32_t& first) {
+		for (auto it = pool.freeRanges.begin(); it != pool.freeRanges.end(); ++it) {
+			if (it->second < count) continue;
+
+			// take the front of the range and keep the rest free
+			first = it->first;
+			uint32_t remaining = it->second - count;
+			pool.freeRanges.erase(it);
+			if (remaining > 0) pool.freeRanges[first + count] = remaining;
+			pool.used += count;
+			return true;
+		}
+		return false;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+#include "buffer.hpp"
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace ToyBox {
+	// suballocates the vertices and indices of every model out of a few large shared device-local buffers,
+	// so models with the same vertex layout and index type draw with offsets from one vertex and index buffer bind.
+	// each pool holds elements of a single size and usage; a new pool is only added when the existing ones are full
+	class GeometryArena {
+	public:
+		static constexpr uint32_t INVALID_POOL = std::numeric_limits<uint32_t>::max();
+		static constexpr VkDeviceSize DEFAULT_VERTEX_POOL_SIZE = 128 * 1024 * 1024; // bytes in each vertex pool
+		static constexpr VkDeviceSize DEFAULT_INDEX_POOL_SIZE = 64 * 1024 * 1024; // bytes in each index pool
+
+		// a range of elements in one pool, offsets and counts are in vertices or indices rather than bytes
+		struct Allocation {
+			uint32_t pool = INVALID_POOL;
+			uint32_t first = 0;
+			uint32_t count = 0;
+
+			bool isValid() const { return pool != INVALID_POOL; }
+		};
+
+		GeometryArena(Device& device, VkDeviceSize vertexPoolSize = DEFAULT_VERTEX_POOL_SIZE, VkDeviceSize indexPoolSize = DEFAULT_INDEX_POOL_SIZE); // constructor
+		~GeometryArena(); // destructor
+
+		// not copyable or movable
+		GeometryArena(const GeometryArena&) = delete;
+		GeometryArena& operator = (const GeometryArena&) = delete;
+
+		Allocation allocateVertices(uint32_t vertexSize, uint32_t count); // reserve count vertices of vertexSize bytes
+		Allocation allocateIndices(VkIndexType indexType, uint32_t count); // reserve count indices of indexType
+		void free(Allocation& allocation); // return the range to its pool and invalidate the allocation
+
+		VkBuffer getBuffer(uint32_t pool) const; // the shared buffer behind a pool
+		VkDeviceSize getElementSize(uint32_t pool) const { return pools[pool].elementSize; } // bytes per vertex or index in a pool
+		size_t getPoolCount() const { return pools.size(); }
+		VkDeviceSize getUsedBytes() const; // bytes handed out across all pools
+		VkDeviceSize getCapacityBytes() const; // bytes reserved across all pools
+
+	private:
+		struct Pool {
+			std::unique_ptr<Buffer> buffer;
+			VkBufferUsageFlags usage = 0;
+			uint32_t elementSize = 0;
+			uint32_t capacity = 0; // in elements
+			uint32_t used = 0; // in elements
+			std::map<uint32_t, uint32_t> freeRanges = {}; // first element -> element count, never adjacent to each other
+		};
+
+		Allocation allocate(VkBufferUsageFlags usage, uint32_t elementSize, uint32_t count, VkDeviceSize poolSize); // first fit over the matching pools, adding one if none has room
+		static bool allocateFromPool(Pool& pool, uint32_t count, uint32_t& first); // first fit inside one pool
+
+		Device& device; // a handle for the device instance
+		VkDeviceSize vertexPoolSize; // a handle for the size of new vertex pools
+		VkDeviceSize indexPoolSize; // a handle for the size of new index pools
+		std::vector<Pool> pools = {}; // a handle for the pools, never removed so pool indices stay valid
+	};
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+// the global uniform buffer shared by every shader, mirroring GlobalUbo in frameinfo.hpp;
+// MAX_LIGHTS sizes the block and has to match the define there, a block's layout can't be specialized
+
+#define MAX_LIGHTS 10
+
+struct PointLight {
+	vec4 position;
+	vec4 color;
+};
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+	mat4 projection;
+	mat4 view;
+	mat4 invView;
+	vec4 ambientLightColor;
+	PointLight pointLights[MAX_LIGHTS];
+	int numLights;
+} ubo;
\ No newline at end of file
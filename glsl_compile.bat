@@ -1,5 +1,13 @@
 A:/Dev/VulkanSDK/Bin/glslc.exe simple_shader.vert -o simple_shader.vert.spv
+A:/Dev/VulkanSDK/Bin/spirv-val.exe simple_shader.vert.spv
+A:/Dev/VulkanSDK/Bin/glslc.exe simple_shader_packed.vert -o simple_shader_packed.vert.spv
+A:/Dev/VulkanSDK/Bin/spirv-val.exe simple_shader_packed.vert.spv
 A:/Dev/VulkanSDK/Bin/glslc.exe simple_shader.frag -o simple_shader.frag.spv
+A:/Dev/VulkanSDK/Bin/spirv-val.exe simple_shader.frag.spv
 A:/Dev/VulkanSDK/Bin/glslc.exe point_light.vert -o point_light.vert.spv
+A:/Dev/VulkanSDK/Bin/spirv-val.exe point_light.vert.spv
 A:/Dev/VulkanSDK/Bin/glslc.exe point_light.frag -o point_light.frag.spv
+A:/Dev/VulkanSDK/Bin/spirv-val.exe point_light.frag.spv
+A:/Dev/VulkanSDK/Bin/glslc.exe cull.comp -o cull.comp.spv
+A:/Dev/VulkanSDK/Bin/spirv-val.exe cull.comp.spv
 pause
\ No newline at end of file
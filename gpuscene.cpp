@@ -0,0 +1,430 @@
+#include "gpuscene.hpp"
+#include "pipeline.hpp"
+#include "pipelinecache.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+namespace ToyBox {
+	static_assert(sizeof(VkDrawIndexedIndirectCommand) == 5 * sizeof(uint32_t), "cull.comp writes tightly packed draw commands");
+
+	GpuScene::GpuScene(Device& device, uint32_t capacity) : device{ device }, capacity{ capacity } {
+		assert(device.isDrawIndirectCountSupported() && "GPU scene needs drawIndirectCount, multiDrawIndirect and drawIndirectFirstInstance");
+		static_assert(sizeof(CullPushConstants) <= 128, "cull.comp's push constants must fit the guaranteed minimum");
+		createBuffers();
+		createPipeline();
+	}
+
+	GpuScene::~GpuScene() {
+		vkDestroyPipeline(device.getDevice(), pipeline, nullptr);
+		vkDestroyPipelineLayout(device.getDevice(), pipelineLayout, nullptr);
+	}
+
+	void GpuScene::createBuffers() {
+		instanceBuffer = std::make_unique<Buffer>(device, sizeof(RenderSystem::InstanceData), capacity, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		objectBuffer = std::make_unique<Buffer>(device, sizeof(CullObject), capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		meshBuffer = std::make_unique<Buffer>(device, sizeof(CullMesh), MAX_MESHES, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		drawCommandBuffer = std::make_unique<Buffer>(device, sizeof(VkDrawIndexedIndirectCommand), capacity * MAX_BATCHES, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		countBuffer = std::make_unique<Buffer>(device, sizeof(uint32_t), MAX_BATCHES, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	}
+
+	void GpuScene::createPipeline() {
+		setLayout = DescriptorSetLayout::Builder(device)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.build();
+		descriptorPool = DescriptorPool::Builder(device).setMaxSets(1).addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4).build();
+
+		// the buffers are written in command buffer order with barriers in between, so one set serves every frame in flight
+		auto objectInfo = objectBuffer->descriptorInfo();
+		auto meshInfo = meshBuffer->descriptorInfo();
+		auto commandInfo = drawCommandBuffer->descriptorInfo();
+		auto countInfo = countBuffer->descriptorInfo();
+		if (!DescriptorWriter(*setLayout, *descriptorPool).writeBuffer(0, &objectInfo).writeBuffer(1, &meshInfo).writeBuffer(2, &commandInfo).writeBuffer(3, &countInfo).build(descriptorSet)) {
+			throw std::runtime_error("failed to allocate gpu scene descriptor set!");
+		}
+
+		VkPushConstantRange pushConstantRange = {};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(CullPushConstants);
+
+		VkDescriptorSetLayout descriptorSetLayout = setLayout->getDescriptorSetLayout();
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+		if (vkCreatePipelineLayout(device.getDevice(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create gpu scene pipeline layout!");
+		}
+
+		auto code = Pipeline::readFile("cull.comp.spv");
+		VkShaderModuleCreateInfo moduleInfo = {};
+		moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		moduleInfo.codeSize = code.size();
+		moduleInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+		VkShaderModule shaderModule = VK_NULL_HANDLE;
+		if (vkCreateShaderModule(device.getDevice(), &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create shader module!");
+		}
+
+		VkComputePipelineCreateInfo pipelineInfo = {};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.module = shaderModule;
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = pipelineLayout;
+		pipelineInfo.basePipelineIndex = -1;
+		VkResult result = vkCreateComputePipelines(device.getDevice(), device.getPipelineCache().getCache(), 1, &pipelineInfo, nullptr, &pipeline);
+		vkDestroyShaderModule(device.getDevice(), shaderModule, nullptr); // only needed while the pipeline is created
+		if (result != VK_SUCCESS) {
+			throw std::runtime_error("failed to create gpu scene culling pipeline!");
+		}
+	}
+
+	VkDeviceSize GpuScene::getUploadSize(size_t objectCount) {
+		return MAX_MESHES * sizeof(CullMesh) + objectCount * (sizeof(RenderSystem::InstanceData) + sizeof(CullObject));
+	}
+
+	void GpuScene::addObject(Entity::id_t id, std::shared_ptr<Model> model, TransformComponent& transform) {
+		assert(slots.count(id) == 0 && "Entity is already in the GPU scene");
+		uint32_t mesh = acquireMesh(model); // first, so the scene is unchanged if there's no room for another model
+
+		// past the capacity the cpu copies keep growing, the next cull grows the buffers to match
+		uint32_t slot = static_cast<uint32_t>(objects.size());
+		slots[id] = slot;
+		slotEntities.push_back(id);
+		objects.emplace_back();
+		instances.emplace_back();
+		dirty.push_back(false);
+		objects[slot].mesh = mesh;
+		writeObject(slot, transform);
+	}
+
+	void GpuScene::updateObject(Entity::id_t id, TransformComponent& transform) {
+		writeObject(slots.at(id), transform);
+	}
+
+	void GpuScene::removeObject(Entity::id_t id) {
+		auto it = slots.find(id);
+		if (it == slots.end()) return;
+		uint32_t slot = it->second;
+		slots.erase(it);
+		releaseMesh(objects[slot].mesh);
+
+		// the last object moves into the freed slot, so the slots stay dense and the culling pass only walks live objects
+		uint32_t last = static_cast<uint32_t>(objects.size()) - 1;
+		if (slot != last) {
+			objects[slot] = objects[last];
+			instances[slot] = instances[last];
+			slotEntities[slot] = slotEntities[last];
+			slots[slotEntities[slot]] = slot;
+			markDirty(slot);
+		}
+		objects.pop_back();
+		instances.pop_back();
+		slotEntities.pop_back();
+		dirty.pop_back();
+		gpuObjectCount = std::min(gpuObjectCount, static_cast<uint32_t>(objects.size()));
+		dirtySlots.erase(std::remove(dirtySlots.begin(), dirtySlots.end(), last), dirtySlots.end());
+	}
+
+	uint32_t GpuScene::acquireMesh(const std::shared_ptr<Model>& model) {
+		auto it = meshIndices.find(model.get());
+		if (it != meshIndices.end()) {
+			meshes[it->second].objectCount++;
+			return it->second;
+		}
+
+		uint32_t mesh = 0;
+		if (!freeMeshes.empty()) {
+			mesh = freeMeshes.back();
+			freeMeshes.pop_back();
+		}
+		else {
+			if (meshes.size() >= MAX_MESHES) {
+				throw std::runtime_error("gpu scene has too many distinct models!");
+			}
+			mesh = static_cast<uint32_t>(meshes.size());
+			meshes.emplace_back();
+		}
+		meshes[mesh].model = model;
+		meshes[mesh].objectCount = 1;
+		meshIndices[model.get()] = mesh;
+		return mesh;
+	}
+
+	void GpuScene::releaseMesh(uint32_t mesh) {
+		if (--meshes[mesh].objectCount > 0) return;
+		meshIndices.erase(meshes[mesh].model.get());
+		meshes[mesh].model = nullptr;
+		freeMeshes.push_back(mesh);
+	}
+
+	void GpuScene::writeObject(uint32_t slot, TransformComponent& transform) {
+		const Model& model = *meshes[objects[slot].mesh].model;
+		glm::mat4 modelMatrix = transform.mat4();
+		instances[slot].modelMatrix = modelMatrix * model.getPositionDequantization();
+		instances[slot].normalMatrix = glm::mat4(transform.normalMatrix());
+
+		CullObject& object = objects[slot];
+		object.scale = glm::max(glm::length(glm::vec3(modelMatrix[0])), glm::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+		object.sphere = glm::vec4(glm::vec3(modelMatrix * glm::vec4(model.getBoundsCenter(), 1.f)), model.getBoundsRadius() * object.scale);
+		markDirty(slot);
+	}
+
+	void GpuScene::markDirty(uint32_t slot) {
+		if (dirty[slot]) return;
+		dirty[slot] = true;
+		dirtySlots.push_back(slot);
+	}
+
+	void GpuScene::grow() {
+		uint32_t newCapacity = capacity;
+		while (newCapacity < objects.size()) newCapacity *= 2;
+		std::cout << "gpu scene: growing from " << capacity << " to " << newCapacity << " objects" << std::endl;
+
+		// rare enough to stall for: the frames in flight stop using the old buffers and the descriptor set, and the copies finish before they're freed
+		vkDeviceWaitIdle(device.getDevice());
+		std::unique_ptr<Buffer> oldInstanceBuffer = std::move(instanceBuffer);
+		std::unique_ptr<Buffer> oldObjectBuffer = std::move(objectBuffer);
+		capacity = newCapacity;
+		createBuffers();
+		device.copyBuffer(oldInstanceBuffer->getBuffer(), instanceBuffer->getBuffer(), oldInstanceBuffer->getBufferSize());
+		device.copyBuffer(oldObjectBuffer->getBuffer(), objectBuffer->getBuffer(), oldObjectBuffer->getBufferSize());
+
+		auto objectInfo = objectBuffer->descriptorInfo();
+		auto meshInfo = meshBuffer->descriptorInfo();
+		auto commandInfo = drawCommandBuffer->descriptorInfo();
+		auto countInfo = countBuffer->descriptorInfo();
+		DescriptorWriter(*setLayout, *descriptorPool).writeBuffer(0, &objectInfo).writeBuffer(1, &meshInfo).writeBuffer(2, &commandInfo).writeBuffer(3, &countInfo).overwrite(descriptorSet);
+
+		// the readbacks were sized for the old command buffer and laid out by the old capacity
+		for (Readback& readback : readbacks) {
+			readback.buffer = nullptr;
+			readback.pending = false;
+		}
+	}
+
+	void GpuScene::refreshMeshes(const Frustum& frustum) {
+		// the residency manager evicts models that go unrequested, so only models with an object in view are requested.
+		// the gpu runs the same sphere test, a model that's out of view here isn't drawn there either
+		if (residencyManager) {
+			meshInView.assign(meshes.size(), 0);
+			for (const CullObject& object : objects) {
+				if (!meshInView[object.mesh] && frustum.intersectsSphere(glm::vec3(object.sphere), object.sphere.w)) meshInView[object.mesh] = 1;
+			}
+		}
+
+		// one entry per model rather than per object, a model moving in the arena after a restream only changes its entry
+		meshTable.assign(meshes.size(), CullMesh{});
+		batches.clear();
+		for (uint32_t mesh = 0; mesh < meshes.size(); mesh++) {
+			if (!meshes[mesh].model) continue;
+			Model& model = *meshes[mesh].model;
+
+			// models out of view keep their entry while they stay resident, so they're drawn as soon as an object comes into view
+			bool resident = residencyManager && meshInView[mesh] ? residencyManager->request(model) : model.isResident();
+			if (!resident || model.getIndexBuffer() == VK_NULL_HANDLE || model.getLods().empty()) continue;
+
+			// models in the same arena buffers share a batch
+			uint32_t batch = 0;
+			while (batch < batches.size() && (batches[batch].vertexFormat != model.getVertexFormat() || batches[batch].vertexBuffer != model.getVertexBuffer() || batches[batch].indexBuffer != model.getIndexBuffer())) batch++;
+			if (batch == batches.size()) {
+				if (batches.size() >= MAX_BATCHES) {
+					throw std::runtime_error("gpu scene has too many batches!");
+				}
+				Batch newBatch = {};
+				newBatch.vertexFormat = model.getVertexFormat();
+				newBatch.vertexBuffer = model.getVertexBuffer();
+				newBatch.indexBuffer = model.getIndexBuffer();
+				newBatch.indexType = model.getIndexType();
+				newBatch.commandOffset = static_cast<VkDeviceSize>(batch) * capacity * sizeof(VkDrawIndexedIndirectCommand);
+				newBatch.countOffset = batch * sizeof(uint32_t);
+				batches.push_back(newBatch);
+			}
+
+			CullMesh& entry = meshTable[mesh];
+			entry.batch = batch;
+			entry.vertexOffset = static_cast<int32_t>(model.getVertexOffset());
+			const auto& lods = model.getLods();
+			entry.lodCount = static_cast<uint32_t>(std::min<size_t>(lods.size(), MAX_LODS));
+			for (int lod = 0; lod < static_cast<int>(entry.lodCount); lod++) {
+				entry.lodErrors[lod] = lods[lod].error;
+				entry.lodFirstIndex[lod] = model.getFirstIndex() + lods[lod].firstIndex;
+				entry.lodIndexCount[lod] = lods[lod].indexCount;
+			}
+		}
+	}
+
+	void GpuScene::uploadObjects(FrameInfo& frameInfo) {
+		VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+		FrameRingBuffer& frameRing = *frameInfo.frameRing;
+
+		if (!meshTable.empty()) {
+			FrameRingBuffer::Allocation meshes = frameRing.allocate(meshTable.size() * sizeof(CullMesh));
+			std::memcpy(meshes.mapped, meshTable.data(), meshes.size);
+			VkBufferCopy copy = { meshes.offset, 0, meshes.size };
+			vkCmdCopyBuffer(commandBuffer, frameRing.getBuffer(), meshBuffer->getBuffer(), 1, &copy);
+		}
+
+		uploadedCount = 0;
+		if (dirtySlots.empty()) {
+			gpuObjectCount = static_cast<uint32_t>(objects.size());
+			return;
+		}
+
+		// changed slots are copied in order, with neighbouring slots merged into one region. only as many as fit in the frame's
+		// partition are copied, lowest first, the rest stay dirty for the next frames
+		std::sort(dirtySlots.begin(), dirtySlots.end());
+		const VkDeviceSize padding = 2 * frameRing.getAlignment();
+		const VkDeviceSize freeBytes = frameRing.getFreeBytes() > padding ? frameRing.getFreeBytes() - padding : 0;
+		const size_t count = std::min<size_t>(dirtySlots.size(), freeBytes / (sizeof(RenderSystem::InstanceData) + sizeof(CullObject)));
+		if (count == 0) return;
+		uploadedCount = static_cast<uint32_t>(count);
+
+		FrameRingBuffer::Allocation instanceData = frameRing.allocate(count * sizeof(RenderSystem::InstanceData));
+		FrameRingBuffer::Allocation objectData = frameRing.allocate(count * sizeof(CullObject));
+		instanceCopies.clear();
+		objectCopies.clear();
+		for (size_t i = 0; i < count; i++) {
+			uint32_t slot = dirtySlots[i];
+			dirty[slot] = false;
+			static_cast<RenderSystem::InstanceData*>(instanceData.mapped)[i] = instances[slot];
+			static_cast<CullObject*>(objectData.mapped)[i] = objects[slot];
+
+			if (i > 0 && dirtySlots[i - 1] + 1 == slot) {
+				instanceCopies.back().size += sizeof(RenderSystem::InstanceData);
+				objectCopies.back().size += sizeof(CullObject);
+				continue;
+			}
+			instanceCopies.push_back({ instanceData.offset + i * sizeof(RenderSystem::InstanceData), slot * sizeof(RenderSystem::InstanceData), sizeof(RenderSystem::InstanceData) });
+			objectCopies.push_back({ objectData.offset + i * sizeof(CullObject), slot * sizeof(CullObject), sizeof(CullObject) });
+		}
+		dirtySlots.erase(dirtySlots.begin(), dirtySlots.begin() + count);
+
+		// slots that never reached the gpu are always still dirty, so every slot below the first one waiting holds uploaded data
+		uint32_t firstWaiting = dirtySlots.empty() ? static_cast<uint32_t>(objects.size()) : dirtySlots.front();
+		gpuObjectCount = std::max(gpuObjectCount, firstWaiting);
+
+		vkCmdCopyBuffer(commandBuffer, frameRing.getBuffer(), instanceBuffer->getBuffer(), static_cast<uint32_t>(instanceCopies.size()), instanceCopies.data());
+		vkCmdCopyBuffer(commandBuffer, frameRing.getBuffer(), objectBuffer->getBuffer(), static_cast<uint32_t>(objectCopies.size()), objectCopies.data());
+	}
+
+	void GpuScene::cull(FrameInfo& frameInfo, float lodThreshold) {
+		assert(frameInfo.frameRing != nullptr && "Cannot cull the GPU scene without a frame ring buffer for its uploads");
+		VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+		checkReadback(frameInfo.frameIndex); // the frame's fence has signalled, so its readback is complete
+		if (objects.size() > capacity) grow();
+		const Frustum frustum = frameInfo.camera.getFrustum();
+		refreshMeshes(frustum);
+
+		// the previous frames' draws and culling read the buffers about to be overwritten
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		uploadObjects(frameInfo);
+		vkCmdFillBuffer(commandBuffer, countBuffer->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		if (gpuObjectCount > 0) {
+			const glm::mat4& projection = frameInfo.camera.getProjection();
+			CullPushConstants push = {};
+			std::copy(std::begin(frustum.planes), std::end(frustum.planes), push.planes);
+			push.cameraPosition = glm::vec4(glm::vec3(frameInfo.camera.getInverseView()[3]), projection[2][3] != 0.f ? 1.f : 0.f);
+			push.objectCount = gpuObjectCount;
+			push.capacity = capacity;
+			push.pixelsPerUnit = projection[1][1] * 0.5f * static_cast<float>(frameInfo.extent.height);
+			push.lodThreshold = frameInfo.extent.height == 0 ? -1.f : lodThreshold;
+
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &push);
+			vkCmdDispatch(commandBuffer, (push.objectCount + 63) / 64, 1, 1); // cull.comp's local size
+		}
+
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		// while uploads are spread over frames the gpu culls some stale objects, which the reference can't reproduce
+		if (validation && dirtySlots.empty()) recordReadback(commandBuffer, frameInfo.frameIndex, frustum);
+	}
+
+	void GpuScene::cullOnCpu(const Frustum& frustum, std::vector<uint32_t>& visibleObjects) const {
+		visibleObjects.clear();
+		for (uint32_t slot = 0; slot < gpuObjectCount; slot++) {
+			const CullObject& object = objects[slot];
+			if (object.mesh >= meshTable.size() || meshTable[object.mesh].batch == INVALID_BATCH) continue;
+			if (frustum.intersectsSphere(glm::vec3(object.sphere), object.sphere.w)) visibleObjects.push_back(slot);
+		}
+	}
+
+	void GpuScene::recordReadback(VkCommandBuffer commandBuffer, int frameIndex, const Frustum& frustum) {
+		Readback& readback = readbacks[frameIndex];
+		if (!readback.buffer) {
+			VkDeviceSize size = countBuffer->getBufferSize() + drawCommandBuffer->getBufferSize();
+			readback.buffer = std::make_unique<Buffer>(device, size, 1, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			readback.buffer->map();
+		}
+
+		// the counts first, then the commands of the batches in use
+		readback.batchCount = static_cast<uint32_t>(batches.size());
+		VkBufferCopy counts = { 0, 0, countBuffer->getBufferSize() };
+		vkCmdCopyBuffer(commandBuffer, countBuffer->getBuffer(), readback.buffer->getBuffer(), 1, &counts);
+		if (readback.batchCount > 0) {
+			VkBufferCopy commands = { 0, countBuffer->getBufferSize(), static_cast<VkDeviceSize>(readback.batchCount) * capacity * sizeof(VkDrawIndexedIndirectCommand) };
+			vkCmdCopyBuffer(commandBuffer, drawCommandBuffer->getBuffer(), readback.buffer->getBuffer(), 1, &commands);
+		}
+
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		cullOnCpu(frustum, readback.reference); // from the same objects and mesh table the gpu culls
+		readback.pending = true;
+	}
+
+	void GpuScene::checkReadback(int frameIndex) {
+		Readback& readback = readbacks[frameIndex];
+		if (!readback.pending) return;
+		readback.pending = false;
+
+		// every visible object is one command, whose first instance is the object's slot
+		const char* mapped = static_cast<const char*>(readback.buffer->getMappedMemory());
+		const uint32_t* counts = reinterpret_cast<const uint32_t*>(mapped);
+		const VkDrawIndexedIndirectCommand* commands = reinterpret_cast<const VkDrawIndexedIndirectCommand*>(mapped + countBuffer->getBufferSize());
+		std::vector<uint32_t> visible = {};
+		for (uint32_t batch = 0; batch < readback.batchCount; batch++) {
+			for (uint32_t i = 0; i < counts[batch]; i++) {
+				visible.push_back(commands[batch * capacity + i].firstInstance);
+			}
+		}
+		std::sort(visible.begin(), visible.end());
+
+		// the reference is in slot order, so the difference falls out of one merge
+		std::vector<uint32_t> difference = {};
+		std::set_symmetric_difference(visible.begin(), visible.end(), readback.reference.begin(), readback.reference.end(), std::back_inserter(difference));
+		validatedFrames++;
+		if (!difference.empty()) {
+			mismatchCount += difference.size();
+			std::cerr << "gpu scene: culling disagrees with the cpu reference on " << difference.size() << " objects (" << visible.size() << " drawn, "
+				<< readback.reference.size() << " expected)" << std::endl;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,167 @@
+#pragma once
+#include "buffer.hpp"
+#include "camera.hpp"
+#include "descriptors.hpp"
+#include "device.hpp"
+#include "entity.hpp"
+#include "frameinfo.hpp"
+#include "model.hpp"
+#include "rendersystem.hpp"
+#include "residencymanager.hpp"
+#include "swapchain.hpp"
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace ToyBox {
+	// the scene kept on the gpu for gpu-driven rendering: object transforms and bounds live in device-local storage buffers
+	// that only changed objects are copied into, and a compute pass frustum culls every object and picks its lod, writing one
+	// VkDrawIndexedIndirectCommand per visible object. models sharing a vertex format and arena buffers form a batch that is
+	// drawn with a single vkCmdDrawIndexedIndirectCount, so a frame costs the cpu per changed object and per model, plus a sphere
+	// test per object to find the models in view when residency is managed. the buffers double when objects outgrow them. a cpu
+	// reference of the culling can be compared against the gpu's visible sets. only used from the main thread
+	class GpuScene {
+	public:
+		static constexpr uint32_t DEFAULT_CAPACITY = 16384; // objects the buffers start with room for
+		static constexpr uint32_t MAX_MESHES = 1024; // distinct models in the scene
+		static constexpr uint32_t MAX_BATCHES = 8; // distinct vertex formats and arena buffers drawn from
+		static constexpr uint32_t MAX_LODS = 4; // lods per model the culling pass picks from, finest first
+		static constexpr uint32_t INVALID_BATCH = ~0u;
+
+		// models sharing a vertex format and arena buffers, drawn with one indirect count draw
+		struct Batch {
+			Model::VertexFormat vertexFormat = Model::VertexFormat::Float;
+			VkBuffer vertexBuffer = VK_NULL_HANDLE;
+			VkBuffer indexBuffer = VK_NULL_HANDLE;
+			VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+			VkDeviceSize commandOffset = 0; // bytes into the draw command buffer
+			VkDeviceSize countOffset = 0; // bytes into the count buffer
+		};
+
+		GpuScene(Device& device, uint32_t capacity = DEFAULT_CAPACITY); // constructor, needs Device::isDrawIndirectCountSupported
+		~GpuScene(); // destructor
+
+		// not copyable or movable
+		GpuScene(const GpuScene&) = delete;
+		GpuScene& operator = (const GpuScene&) = delete;
+
+		void addObject(Entity::id_t id, std::shared_ptr<Model> model, TransformComponent& transform); // start drawing an entity, copied to the gpu with the next cull, which grows the buffers if needed
+		void updateObject(Entity::id_t id, TransformComponent& transform); // after the entity moved
+		void removeObject(Entity::id_t id); // stop drawing an entity
+		bool hasObject(Entity::id_t id) const { return slots.count(id) > 0; }
+		static VkDeviceSize getUploadSize(size_t objectCount); // frame ring bytes a cull needs when objectCount objects changed, with the mesh table
+
+		// record the changed objects' copies and the culling pass, before the render pass begins; the frame's ring partition
+		// carries the copies. a negative lod threshold draws every object at full detail
+		void cull(FrameInfo& frameInfo, float lodThreshold);
+		void cullOnCpu(const Frustum& frustum, std::vector<uint32_t>& visibleObjects) const; // the reference: slots of the objects the gpu should draw, in slot order, among those uploaded
+
+		void setResidencyManager(ResidencyManager* manager) { residencyManager = manager; } // models with an object in view are requested every frame
+		void setValidation(bool enabled) { validation = enabled; } // read the visible sets back and compare them with cullOnCpu, a frame in flight later
+
+		const std::vector<Batch>& getBatches() const { return batches; } // this frame's batches, after cull
+		VkBuffer getInstanceBuffer() const { return instanceBuffer->getBuffer(); } // RenderSystem::InstanceData per slot, for vertex binding 1
+		VkBuffer getDrawCommandBuffer() const { return drawCommandBuffer->getBuffer(); }
+		VkBuffer getCountBuffer() const { return countBuffer->getBuffer(); }
+		uint32_t getCapacity() const { return capacity; } // the most draws a batch can have, changes when the buffers grow
+		uint32_t getObjectCount() const { return static_cast<uint32_t>(objects.size()); }
+		uint32_t getUploadedCount() const { return uploadedCount; } // objects copied to the gpu last frame, at most what fits in the frame ring
+		uint32_t getPendingUploadCount() const { return static_cast<uint32_t>(dirtySlots.size()); } // changed objects still waiting for room in the frame ring
+		uint64_t getValidatedFrames() const { return validatedFrames; }
+		uint64_t getMismatchCount() const { return mismatchCount; } // objects the gpu and the reference disagreed on, over every validated frame
+
+	private:
+		// culling data of one object, laid out as cull.comp reads it
+		struct CullObject {
+			glm::vec4 sphere = {}; // world space center and radius
+			float scale = 1.f; // largest axis scale
+			uint32_t mesh = 0;
+			uint32_t padding[2] = {};
+		};
+
+		// the draw ranges of one model, laid out as cull.comp reads it
+		struct CullMesh {
+			uint32_t batch = INVALID_BATCH;
+			int32_t vertexOffset = 0;
+			uint32_t lodCount = 0;
+			uint32_t padding = 0;
+			glm::vec4 lodErrors = {};
+			glm::uvec4 lodFirstIndex = {};
+			glm::uvec4 lodIndexCount = {};
+		};
+
+		// cull.comp's push constants
+		struct CullPushConstants {
+			glm::vec4 planes[6] = {};
+			glm::vec4 cameraPosition = {};
+			uint32_t objectCount = 0;
+			uint32_t capacity = 0;
+			float pixelsPerUnit = 0.f;
+			float lodThreshold = 0.f;
+		};
+
+		// a model drawn by the scene
+		struct Mesh {
+			std::shared_ptr<Model> model;
+			uint32_t objectCount = 0;
+		};
+
+		// the gpu's visible sets of a frame in flight, read once its fence has signalled
+		struct Readback {
+			std::unique_ptr<Buffer> buffer;
+			std::vector<uint32_t> reference = {}; // cullOnCpu at the time of the cull
+			uint32_t batchCount = 0;
+			bool pending = false;
+		};
+
+		void createBuffers(); // to create the scene buffers at the current capacity
+		void createPipeline(); // to create the descriptor set and the culling pipeline
+		uint32_t acquireMesh(const std::shared_ptr<Model>& model); // the model's mesh index, adding it if it's new
+		void releaseMesh(uint32_t mesh); // drop an object's reference to its mesh
+		void writeObject(uint32_t slot, TransformComponent& transform); // fill the cpu copies of a slot and mark it for upload
+		void markDirty(uint32_t slot);
+		void grow(); // double the object buffers until every object fits, waiting for the device to go idle first
+		void refreshMeshes(const Frustum& frustum); // rebuild the mesh table and batches from the models' current residency and arena ranges
+		void uploadObjects(FrameInfo& frameInfo); // record the copies of the mesh table and of as many changed objects as fit in the frame ring
+		void recordReadback(VkCommandBuffer commandBuffer, int frameIndex, const Frustum& frustum); // copy the visible sets for validation and keep the reference
+		void checkReadback(int frameIndex); // compare a finished frame's visible sets with its reference
+
+		Device& device; // a handle for the device instance
+		uint32_t capacity; // a handle for the object capacity
+		ResidencyManager* residencyManager = nullptr; // a handle for the residency manager, if any
+		bool validation = false; // a flag for comparing the gpu culling with the cpu reference
+
+		std::unordered_map<Entity::id_t, uint32_t> slots = {}; // a handle for the slot of each entity
+		std::vector<Entity::id_t> slotEntities = {}; // a handle for the entity in each slot
+		std::vector<CullObject> objects = {}; // a handle for the cpu copy of the culling data, by slot
+		std::vector<RenderSystem::InstanceData> instances = {}; // a handle for the cpu copy of the instance data, by slot
+		std::vector<uint32_t> dirtySlots = {}; // a handle for the slots changed since the last upload
+		std::vector<bool> dirty = {}; // a handle for whether each slot is in dirtySlots
+		std::unordered_map<const Model*, uint32_t> meshIndices = {}; // a handle for the mesh index of each model
+		std::vector<Mesh> meshes = {}; // a handle for the models by mesh index
+		std::vector<uint32_t> freeMeshes = {}; // a handle for mesh indices no object uses
+		std::vector<uint8_t> meshInView = {}; // a handle for whether each mesh has an object in this frame's frustum, kept to reuse its memory
+		std::vector<CullMesh> meshTable = {}; // a handle for this frame's mesh table
+		std::vector<Batch> batches = {}; // a handle for this frame's batches
+		std::vector<VkBufferCopy> instanceCopies = {}; // a handle for this frame's instance copies, kept to reuse its memory
+		std::vector<VkBufferCopy> objectCopies = {}; // a handle for this frame's object copies, kept to reuse its memory
+		uint32_t uploadedCount = 0; // a handle for the objects copied last frame
+		uint32_t gpuObjectCount = 0; // a handle for the leading slots whose data has reached the gpu, the ones the culling pass walks
+
+		std::unique_ptr<Buffer> instanceBuffer; // a handle for the instance data buffer
+		std::unique_ptr<Buffer> objectBuffer; // a handle for the culling data buffer
+		std::unique_ptr<Buffer> meshBuffer; // a handle for the mesh table buffer
+		std::unique_ptr<Buffer> drawCommandBuffer; // a handle for the draw commands the culling pass writes, capacity per batch
+		std::unique_ptr<Buffer> countBuffer; // a handle for the draw count of each batch
+		std::array<Readback, SwapChain::MAX_FRAMES_IN_FLIGHT> readbacks = {}; // a handle for the validation readbacks of each frame in flight
+		uint64_t validatedFrames = 0; // a handle for the number of compared frames
+		uint64_t mismatchCount = 0; // a handle for the number of objects that differed
+
+		std::unique_ptr<DescriptorSetLayout> setLayout; // a handle for the culling descriptor set layout
+		std::unique_ptr<DescriptorPool> descriptorPool; // a handle for the pool of the culling descriptor set
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE; // a handle for the culling descriptor set
+		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE; // a handle for the culling pipeline layout
+		VkPipeline pipeline = VK_NULL_HANDLE; // a handle for the culling pipeline
+	};
+}
\ No newline at end of file
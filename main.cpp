@@ -1,10 +1,32 @@
 #include "application.hpp"
+#include "objloader.hpp"
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
-int main() {
-	ToyBox::Application app = {};
+int main(int argc, char** argv) {
+	// measure model loading throughput without opening a window: --bench-obj <file.obj>
+	if (argc == 3 && std::strcmp(argv[1], "--bench-obj") == 0) {
+		try {
+			ToyBox::ObjLoader::benchmark(argv[2]);
+		}
+
+		catch (const std::exception& e) {
+			std::cerr << e.what() << '\n';
+			return EXIT_FAILURE;
+		}
+
+		return EXIT_SUCCESS;
+	}
+
+	// compare the recording time with fewer threads: --record-threads <count>
+	unsigned int recordThreads = 0;
+	if (argc == 3 && std::strcmp(argv[1], "--record-threads") == 0) {
+		recordThreads = static_cast<unsigned int>(std::strtoul(argv[2], nullptr, 10));
+	}
+
+	ToyBox::Application app{ recordThreads };
 
 	try {
 		app.run();
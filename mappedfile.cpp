@@ -0,0 +1,79 @@
+#include "mappedfile.hpp"
+#include <stdexcept>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ToyBox {
+#ifdef _WIN32
+	MappedFile::MappedFile(const std::string& filepath) {
+		HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			throw std::runtime_error("failed to open file: " + filepath);
+		}
+		fileHandle = file;
+
+		LARGE_INTEGER size = {};
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+			CloseHandle(file);
+			throw std::runtime_error("failed to map empty file: " + filepath);
+		}
+		fileSize = static_cast<size_t>(size.QuadPart);
+
+		// map the whole file as a read-only view
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr) {
+			CloseHandle(file);
+			throw std::runtime_error("failed to create file mapping: " + filepath);
+		}
+		mappingHandle = mapping;
+
+		mapped = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		if (mapped == nullptr) {
+			CloseHandle(mapping);
+			CloseHandle(file);
+			throw std::runtime_error("failed to map file: " + filepath);
+		}
+	}
+
+	MappedFile::~MappedFile() {
+		UnmapViewOfFile(mapped);
+		CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+	}
+#else
+	MappedFile::MappedFile(const std::string& filepath) {
+		fileDescriptor = open(filepath.c_str(), O_RDONLY);
+		if (fileDescriptor < 0) {
+			throw std::runtime_error("failed to open file: " + filepath);
+		}
+
+		struct stat info = {};
+		if (fstat(fileDescriptor, &info) != 0 || info.st_size == 0) {
+			close(fileDescriptor);
+			throw std::runtime_error("failed to map empty file: " + filepath);
+		}
+		fileSize = static_cast<size_t>(info.st_size);
+
+		// map the whole file as a read-only view
+		void* view = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+		if (view == MAP_FAILED) {
+			close(fileDescriptor);
+			throw std::runtime_error("failed to map file: " + filepath);
+		}
+		mapped = static_cast<const uint8_t*>(view);
+	}
+
+	MappedFile::~MappedFile() {
+		munmap(const_cast<uint8_t*>(mapped), fileSize);
+		close(fileDescriptor);
+	}
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ToyBox {
+	// read-only memory mapping of a whole file, unmapped when the object is destroyed
+	class MappedFile {
+	public:
+		MappedFile(const std::string& filepath); // constructor, throws if the file can't be opened or mapped
+		~MappedFile(); // destructor
+
+		// not copyable or movable
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator = (const MappedFile&) = delete;
+
+		const uint8_t* data() const { return mapped; }
+		size_t size() const { return fileSize; }
+
+	private:
+		const uint8_t* mapped = nullptr; // a handle for the start of the mapped view
+		size_t fileSize = 0; // the size of the mapped view in bytes
+#ifdef _WIN32
+		void* fileHandle = nullptr; // a handle for the open file
+		void* mappingHandle = nullptr; // a handle for the file mapping object
+#else
+		int fileDescriptor = -1; // a handle for the open file
+#endif
+	};
+}
\ No newline at end of file
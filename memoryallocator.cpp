@@ -0,0 +1,415 @@
+#include "memoryallocator.hpp"
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace ToyBox {
+	// index of the highest set bit, value must not be 0
+	static uint32_t highestBit(uint64_t value) {
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return static_cast<uint32_t>(index);
+#else
+		return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+	}
+
+	// index of the lowest set bit, value must not be 0
+	static uint32_t lowestBit(uint64_t value) {
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return static_cast<uint32_t>(index);
+#else
+		return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+	}
+
+	// round up to a power of two alignment
+	static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	MemoryAllocator::MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize) : device{ device }, blockSize{ blockSize } {
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+		pools.resize(memoryProperties.memoryTypeCount * 2);
+		heapBytes.resize(memoryProperties.memoryHeapCount);
+	}
+
+	MemoryAllocator::~MemoryAllocator() {
+		for (auto& pool : pools) {
+			for (auto& block : pool.blocks) {
+				if (block) vkFreeMemory(device, block->memory, nullptr);
+			}
+		}
+	}
+
+	MemoryAllocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear) {
+		std::lock_guard<std::mutex> lock{ mutex };
+
+		MemoryAllocation allocation = {};
+		allocation.memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+		VkMemoryPropertyFlags typeFlags = memoryProperties.memoryTypes[allocation.memoryType].propertyFlags;
+		VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+		allocation.size = requirements.size;
+
+		// non-coherent ranges are flushed in whole atoms, so keep neighbouring allocations out of each other's atoms
+		if ((typeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(typeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+			alignment = std::max(alignment, nonCoherentAtomSize);
+			allocation.size = alignUp(allocation.size, nonCoherentAtomSize);
+		}
+
+		// small heaps (like the host visible window into vram) get smaller blocks so one block can't take most of the heap
+		VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[allocation.memoryType].heapIndex].size;
+		VkDeviceSize preferredBlockSize = std::min(blockSize, std::max<VkDeviceSize>(heapSize / 8, 1));
+
+		// resources of half a block or more get their own memory object rather than hogging a block
+		if (allocation.size < preferredBlockSize / 2) {
+			allocation.pool = allocation.memoryType * 2 + (linear ? 0 : 1);
+			Pool& pool = pools[allocation.pool];
+			for (uint32_t i = 0; i < pool.blocks.size(); i++) {
+				Block* block = pool.blocks[i].get();
+				if (block && block->allocate(allocation.size, alignment, allocation.offset, allocation.node)) {
+					allocation.block = i;
+					allocation.memory = block->memory;
+					allocation.mapped = block->mapped ? static_cast<char*>(block->mapped) + allocation.offset : nullptr;
+					return allocation;
+				}
+			}
+
+			// every block is full, so add one, reusing the slot of a released block if there is one
+			auto block = std::make_unique<Block>();
+			if (allocateMemory(allocation.memoryType, preferredBlockSize, block->memory, block->mapped)) {
+				block->initialize(preferredBlockSize);
+				block->allocate(allocation.size, alignment, allocation.offset, allocation.node);
+
+				auto slot = std::find(pool.blocks.begin(), pool.blocks.end(), nullptr);
+				allocation.block = static_cast<uint32_t>(slot - pool.blocks.begin());
+				allocation.memory = block->memory;
+				allocation.mapped = block->mapped ? static_cast<char*>(block->mapped) + allocation.offset : nullptr;
+				if (slot == pool.blocks.end()) pool.blocks.push_back(std::move(block));
+				else *slot = std::move(block);
+				return allocation;
+			}
+			// a whole block didn't fit in the heap, the resource on its own still might
+		}
+
+		allocation.block = MemoryAllocation::DEDICATED;
+		allocation.offset = 0;
+		if (!allocateMemory(allocation.memoryType, allocation.size, allocation.memory, allocation.mapped)) {
+			throw OutOfDeviceMemoryError("failed to allocate device memory!");
+		}
+		dedicatedCount++;
+		dedicatedBytes += allocation.size;
+		return allocation;
+	}
+
+	void MemoryAllocator::free(MemoryAllocation& allocation) {
+		if (!allocation.isValid()) return;
+		std::lock_guard<std::mutex> lock{ mutex };
+
+		if (allocation.block == MemoryAllocation::DEDICATED) {
+			freeMemory(allocation.memoryType, allocation.size, allocation.memory);
+			dedicatedCount--;
+			dedicatedBytes -= allocation.size;
+		}
+		else {
+			Pool& pool = pools[allocation.pool];
+			auto& block = pool.blocks[allocation.block];
+			block->free(allocation.node);
+
+			// keep one empty block per pool, so freeing and recreating a resource doesn't hit vkAllocateMemory every time
+			if (block->allocationCount == 0) {
+				bool otherEmptyBlock = false;
+				for (const auto& other : pool.blocks) {
+					if (other && other != block && other->allocationCount == 0) otherEmptyBlock = true;
+				}
+				if (otherEmptyBlock) {
+					freeMemory(allocation.memoryType, block->size, block->memory);
+					block.reset();
+				}
+			}
+		}
+
+		allocation = {};
+	}
+
+	VkResult MemoryAllocator::flush(const MemoryAllocation& allocation, VkDeviceSize offset, VkDeviceSize size) {
+		VkMappedMemoryRange range = mappedRange(allocation, offset, size);
+		return vkFlushMappedMemoryRanges(device, 1, &range);
+	}
+
+	VkResult MemoryAllocator::invalidate(const MemoryAllocation& allocation, VkDeviceSize offset, VkDeviceSize size) {
+		VkMappedMemoryRange range = mappedRange(allocation, offset, size);
+		return vkInvalidateMappedMemoryRanges(device, 1, &range);
+	}
+
+	VkDeviceSize MemoryAllocator::getHeapUsage(uint32_t heapIndex) {
+		std::lock_guard<std::mutex> lock{ mutex };
+		return heapIndex < heapBytes.size() ? heapBytes[heapIndex] : 0;
+	}
+
+	MemoryAllocator::Stats MemoryAllocator::getStats() {
+		std::lock_guard<std::mutex> lock{ mutex };
+
+		Stats stats = {};
+		VkDeviceSize largestFreeRangeSum = 0;
+		for (const auto& pool : pools) {
+			for (const auto& block : pool.blocks) {
+				if (!block) continue;
+				VkDeviceSize largestFreeRange = block->getLargestFreeRange();
+				stats.blockCount++;
+				stats.allocationCount += block->allocationCount;
+				stats.reservedBytes += block->size;
+				stats.usedBytes += block->usedBytes;
+				stats.freeBytes += block->size - block->usedBytes;
+				stats.largestFreeRange = std::max(stats.largestFreeRange, largestFreeRange);
+				largestFreeRangeSum += largestFreeRange;
+			}
+		}
+		stats.dedicatedCount = dedicatedCount;
+		stats.allocationCount += dedicatedCount;
+		stats.reservedBytes += dedicatedBytes;
+		stats.usedBytes += dedicatedBytes;
+
+		// a block whose free space is one range isn't fragmented, however much of it is used
+		if (stats.freeBytes > 0) stats.fragmentation = 1.f - static_cast<float>(largestFreeRangeSum) / static_cast<float>(stats.freeBytes);
+		return stats;
+	}
+
+	void MemoryAllocator::printStats() {
+		Stats stats = getStats();
+		const double megabyte = 1024.0 * 1024.0;
+		std::cout << "memory allocator: " << stats.allocationCount << " allocations in " << stats.blockCount << " blocks and " << stats.dedicatedCount << " dedicated, "
+			<< stats.usedBytes / megabyte << " of " << stats.reservedBytes / megabyte << " MB used, largest free range " << stats.largestFreeRange / megabyte
+			<< " MB, fragmentation " << stats.fragmentation << std::endl;
+	}
+
+	bool MemoryAllocator::allocateMemory(uint32_t memoryType, VkDeviceSize size, VkDeviceMemory& memory, void*& mapped) {
+		VkMemoryAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = size;
+		allocInfo.memoryTypeIndex = memoryType;
+		if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+			memory = VK_NULL_HANDLE;
+			return false;
+		}
+
+		// host visible memory stays mapped for its whole life, since a memory object can only be mapped once at a time
+		mapped = nullptr;
+		if (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+			if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+				vkFreeMemory(device, memory, nullptr);
+				memory = VK_NULL_HANDLE;
+				return false;
+			}
+		}
+		heapBytes[memoryProperties.memoryTypes[memoryType].heapIndex] += size;
+		return true;
+	}
+
+	void MemoryAllocator::freeMemory(uint32_t memoryType, VkDeviceSize size, VkDeviceMemory memory) {
+		vkFreeMemory(device, memory, nullptr);
+		heapBytes[memoryProperties.memoryTypes[memoryType].heapIndex] -= size;
+	}
+
+	uint32_t MemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+			if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+				return i;
+			}
+		}
+
+		throw std::runtime_error("failed to find suitable memory type!");
+	}
+
+	VkMappedMemoryRange MemoryAllocator::mappedRange(const MemoryAllocation& allocation, VkDeviceSize offset, VkDeviceSize size) {
+		VkDeviceSize memorySize = allocation.size;
+		if (allocation.block != MemoryAllocation::DEDICATED) {
+			std::lock_guard<std::mutex> lock{ mutex };
+			memorySize = pools[allocation.pool].blocks[allocation.block]->size;
+		}
+
+		VkDeviceSize begin = allocation.offset + offset;
+		VkDeviceSize end = size == VK_WHOLE_SIZE ? allocation.offset + allocation.size : begin + size;
+		begin -= begin % nonCoherentAtomSize;
+		end = alignUp(end, nonCoherentAtomSize);
+
+		VkMappedMemoryRange range = {};
+		range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		range.memory = allocation.memory;
+		range.offset = begin;
+		range.size = end >= memorySize ? VK_WHOLE_SIZE : end - begin;
+		return range;
+	}
+
+	void MemoryAllocator::Block::initialize(VkDeviceSize blockSize) {
+		size = blockSize;
+		nodes.assign(1, Node{});
+		nodes[0].size = blockSize;
+		insertFree(0);
+	}
+
+	bool MemoryAllocator::Block::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint32_t& node) {
+		// round up to the start of the next size class, so every range in the class found is large enough even after aligning
+		VkDeviceSize searchSize = size + alignment - 1;
+		if (searchSize >= SMALL_SIZE) searchSize += (VkDeviceSize(1) << (highestBit(searchSize) - SECOND_LEVEL_BITS)) - 1;
+		else searchSize += SMALL_SIZE / SECOND_LEVEL_COUNT - 1;
+
+		uint32_t firstLevel, secondLevel;
+		mapping(searchSize, firstLevel, secondLevel);
+		if (firstLevel >= FIRST_LEVEL_COUNT) return false;
+
+		// a free range in this first level at or above the size class, otherwise the smallest one in a higher first level
+		uint32_t secondLevelMap = secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+		if (secondLevelMap == 0) {
+			uint64_t firstLevelMap = firstLevel + 1 < 64 ? firstLevelBitmap & (~uint64_t(0) << (firstLevel + 1)) : 0;
+			if (firstLevelMap == 0) return false;
+			firstLevel = lowestBit(firstLevelMap);
+			secondLevelMap = secondLevelBitmaps[firstLevel];
+		}
+		secondLevel = lowestBit(secondLevelMap);
+
+		node = freeHeads[firstLevel * SECOND_LEVEL_COUNT + secondLevel];
+		removeFree(node);
+
+		// the bytes skipped for alignment stay free as a range of their own; the range before is in use, or they'd have been merged
+		VkDeviceSize padding = alignUp(nodes[node].offset, alignment) - nodes[node].offset;
+		if (padding > 0) {
+			uint32_t front = createNode();
+			nodes[front].offset = nodes[node].offset;
+			nodes[front].size = padding;
+			nodes[front].previousPhysical = nodes[node].previousPhysical;
+			nodes[front].nextPhysical = node;
+			if (nodes[front].previousPhysical != INVALID_NODE) nodes[nodes[front].previousPhysical].nextPhysical = front;
+			nodes[node].previousPhysical = front;
+			nodes[node].offset += padding;
+			nodes[node].size -= padding;
+			insertFree(front);
+		}
+
+		// return the tail to the free lists unless it's too small to ever be used
+		VkDeviceSize remaining = nodes[node].size - size;
+		if (remaining >= SMALL_SIZE / SECOND_LEVEL_COUNT) {
+			uint32_t back = createNode();
+			nodes[back].offset = nodes[node].offset + size;
+			nodes[back].size = remaining;
+			nodes[back].previousPhysical = node;
+			nodes[back].nextPhysical = nodes[node].nextPhysical;
+			if (nodes[back].nextPhysical != INVALID_NODE) nodes[nodes[back].nextPhysical].previousPhysical = back;
+			nodes[node].nextPhysical = back;
+			nodes[node].size = size;
+			insertFree(back);
+		}
+
+		nodes[node].free = false;
+		offset = nodes[node].offset;
+		allocationCount++;
+		usedBytes += nodes[node].size;
+		return true;
+	}
+
+	void MemoryAllocator::Block::free(uint32_t node) {
+		assert(!nodes[node].free && "Memory range freed twice");
+		allocationCount--;
+		usedBytes -= nodes[node].size;
+
+		// merge with free physical neighbours, so free ranges are never adjacent
+		uint32_t previous = nodes[node].previousPhysical;
+		if (previous != INVALID_NODE && nodes[previous].free) {
+			removeFree(previous);
+			nodes[previous].size += nodes[node].size;
+			nodes[previous].nextPhysical = nodes[node].nextPhysical;
+			if (nodes[node].nextPhysical != INVALID_NODE) nodes[nodes[node].nextPhysical].previousPhysical = previous;
+			unusedNodes.push_back(node);
+			node = previous;
+		}
+		uint32_t next = nodes[node].nextPhysical;
+		if (next != INVALID_NODE && nodes[next].free) {
+			removeFree(next);
+			nodes[node].size += nodes[next].size;
+			nodes[node].nextPhysical = nodes[next].nextPhysical;
+			if (nodes[next].nextPhysical != INVALID_NODE) nodes[nodes[next].nextPhysical].previousPhysical = node;
+			unusedNodes.push_back(next);
+		}
+		insertFree(node);
+	}
+
+	VkDeviceSize MemoryAllocator::Block::getLargestFreeRange() const {
+		if (firstLevelBitmap == 0) return 0;
+
+		// the largest range is in the highest non-empty size class, whose ranges differ by less than the class width
+		uint32_t firstLevel = highestBit(firstLevelBitmap);
+		uint32_t secondLevel = highestBit(secondLevelBitmaps[firstLevel]);
+		VkDeviceSize largest = 0;
+		for (uint32_t node = freeHeads[firstLevel * SECOND_LEVEL_COUNT + secondLevel]; node != INVALID_NODE; node = nodes[node].nextFree) {
+			largest = std::max(largest, nodes[node].size);
+		}
+		return largest;
+	}
+
+	void MemoryAllocator::Block::mapping(VkDeviceSize size, uint32_t& firstLevel, uint32_t& secondLevel) {
+		if (size < SMALL_SIZE) {
+			firstLevel = 0;
+			secondLevel = static_cast<uint32_t>(size / (SMALL_SIZE / SECOND_LEVEL_COUNT));
+		}
+		else {
+			uint32_t log2 = highestBit(size);
+			firstLevel = log2 - SMALL_SIZE_BITS + 1;
+			secondLevel = static_cast<uint32_t>(size >> (log2 - SECOND_LEVEL_BITS)) ^ SECOND_LEVEL_COUNT;
+		}
+	}
+
+	uint32_t MemoryAllocator::Block::createNode() {
+		if (!unusedNodes.empty()) {
+			uint32_t node = unusedNodes.back();
+			unusedNodes.pop_back();
+			nodes[node] = {};
+			return node;
+		}
+		nodes.push_back({});
+		return static_cast<uint32_t>(nodes.size() - 1);
+	}
+
+	void MemoryAllocator::Block::insertFree(uint32_t node) {
+		uint32_t firstLevel, secondLevel;
+		mapping(nodes[node].size, firstLevel, secondLevel);
+		uint32_t& head = freeHeads[firstLevel * SECOND_LEVEL_COUNT + secondLevel];
+
+		nodes[node].free = true;
+		nodes[node].previousFree = INVALID_NODE;
+		nodes[node].nextFree = head;
+		if (head != INVALID_NODE) nodes[head].previousFree = node;
+		head = node;
+
+		secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+		firstLevelBitmap |= uint64_t(1) << firstLevel;
+	}
+
+	void MemoryAllocator::Block::removeFree(uint32_t node) {
+		uint32_t firstLevel, secondLevel;
+		mapping(nodes[node].size, firstLevel, secondLevel);
+		uint32_t& head = freeHeads[firstLevel * SECOND_LEVEL_COUNT + secondLevel];
+
+		if (nodes[node].previousFree != INVALID_NODE) nodes[nodes[node].previousFree].nextFree = nodes[node].nextFree;
+		if (nodes[node].nextFree != INVALID_NODE) nodes[nodes[node].nextFree].previousFree = nodes[node].previousFree;
+		if (head == node) {
+			head = nodes[node].nextFree;
+			if (head == INVALID_NODE) {
+				secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+				if (secondLevelBitmaps[firstLevel] == 0) firstLevelBitmap &= ~(uint64_t(1) << firstLevel);
+			}
+		}
+		nodes[node].free = false;
+		nodes[node].previousFree = INVALID_NODE;
+		nodes[node].nextFree = INVALID_NODE;
+	}
+}
\ No newline at end of file
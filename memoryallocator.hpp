@@ -0,0 +1,137 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace ToyBox {
+	// a range of device memory handed out by the MemoryAllocator
+	struct MemoryAllocation {
+		static constexpr uint32_t DEDICATED = std::numeric_limits<uint32_t>::max();
+
+		VkDeviceMemory memory = VK_NULL_HANDLE; // the shared block (or dedicated allocation) to bind at offset
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		void* mapped = nullptr; // host pointer to offset, for host visible memory
+		uint32_t memoryType = 0;
+		uint32_t pool = 0; // internal: where the range goes back to on free
+		uint32_t block = DEDICATED;
+		uint32_t node = 0;
+
+		bool isValid() const { return memory != VK_NULL_HANDLE; }
+	};
+
+	// thrown by MemoryAllocator::allocate when vkAllocateMemory fails, so callers can tell running out of memory apart from
+	// other failures and free something before trying again
+	class OutOfDeviceMemoryError : public std::runtime_error {
+	public:
+		using std::runtime_error::runtime_error;
+	};
+
+	// suballocates buffers and images out of large VkDeviceMemory blocks instead of calling vkAllocateMemory per resource.
+	// every memory type has two pools of blocks, one for linear resources (buffers) and one for optimal tiling images,
+	// so bufferImageGranularity conflicts can't happen; inside a block ranges come from a two-level segregated fit (TLSF)
+	// allocator, which finds a good fit in constant time and merges freed ranges with their neighbours
+	class MemoryAllocator {
+	public:
+		static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64 * 1024 * 1024; // bytes per block, smaller on small heaps
+
+		// totals over every pool, fragmentation is 0 when each block's free space is one range and approaches 1 as it splinters
+		struct Stats {
+			uint32_t blockCount = 0;
+			uint32_t dedicatedCount = 0;
+			uint32_t allocationCount = 0;
+			VkDeviceSize reservedBytes = 0; // held in device memory objects
+			VkDeviceSize usedBytes = 0;
+			VkDeviceSize freeBytes = 0;
+			VkDeviceSize largestFreeRange = 0;
+			float fragmentation = 0.f;
+		};
+
+		MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE); // constructor
+		~MemoryAllocator(); // destructor, frees every block
+
+		// not copyable or movable
+		MemoryAllocator(const MemoryAllocator&) = delete;
+		MemoryAllocator& operator = (const MemoryAllocator&) = delete;
+
+		// allocate memory for a resource, linear is true for buffers and linear images, false for optimal tiling images
+		MemoryAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear);
+		void free(MemoryAllocation& allocation); // return the range and invalidate the allocation
+
+		// flush or invalidate part of a host visible allocation, offsets are relative to the allocation
+		VkResult flush(const MemoryAllocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+		VkResult invalidate(const MemoryAllocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+		VkDeviceSize getHeapUsage(uint32_t heapIndex); // bytes held in device memory objects on a heap
+		Stats getStats();
+		void printStats(); // write the stats to std::cout
+
+	private:
+		static constexpr uint32_t INVALID_NODE = std::numeric_limits<uint32_t>::max();
+		static constexpr uint32_t SECOND_LEVEL_BITS = 5; // 32 size classes between consecutive powers of two
+		static constexpr uint32_t SECOND_LEVEL_COUNT = 1u << SECOND_LEVEL_BITS;
+		static constexpr uint32_t SMALL_SIZE_BITS = 8; // ranges below 256 bytes share the first level, split linearly
+		static constexpr VkDeviceSize SMALL_SIZE = VkDeviceSize(1) << SMALL_SIZE_BITS;
+		static constexpr uint32_t FIRST_LEVEL_COUNT = 64 - SMALL_SIZE_BITS + 1;
+
+		// one range of a block, linked to its physical neighbours and, while free, to the other free ranges of its size class
+		struct Node {
+			VkDeviceSize offset = 0;
+			VkDeviceSize size = 0;
+			uint32_t previousPhysical = INVALID_NODE;
+			uint32_t nextPhysical = INVALID_NODE;
+			uint32_t previousFree = INVALID_NODE;
+			uint32_t nextFree = INVALID_NODE;
+			bool free = false;
+		};
+
+		// one VkDeviceMemory and the TLSF state of the ranges in it
+		struct Block {
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkDeviceSize size = 0;
+			void* mapped = nullptr;
+			std::vector<Node> nodes = {};
+			std::vector<uint32_t> unusedNodes = {};
+			uint64_t firstLevelBitmap = 0; // a bit per first level with any free range
+			uint32_t secondLevelBitmaps[FIRST_LEVEL_COUNT] = {}; // a bit per size class with any free range
+			std::vector<uint32_t> freeHeads = std::vector<uint32_t>(FIRST_LEVEL_COUNT * SECOND_LEVEL_COUNT, INVALID_NODE);
+			uint32_t allocationCount = 0;
+			VkDeviceSize usedBytes = 0;
+
+			void initialize(VkDeviceSize size); // one free range over the whole block
+			bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint32_t& node);
+			void free(uint32_t node);
+			VkDeviceSize getLargestFreeRange() const;
+
+		private:
+			static void mapping(VkDeviceSize size, uint32_t& firstLevel, uint32_t& secondLevel);
+			uint32_t createNode();
+			void insertFree(uint32_t node);
+			void removeFree(uint32_t node);
+		};
+
+		// the blocks of one memory type and resource kind, empty slots are reused so block indices stay valid
+		struct Pool {
+			std::vector<std::unique_ptr<Block>> blocks = {};
+		};
+
+		bool allocateMemory(uint32_t memoryType, VkDeviceSize size, VkDeviceMemory& memory, void*& mapped); // vkAllocateMemory, mapping host visible memory
+		void freeMemory(uint32_t memoryType, VkDeviceSize size, VkDeviceMemory memory); // vkFreeMemory, which also unmaps
+		uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+		VkMappedMemoryRange mappedRange(const MemoryAllocation& allocation, VkDeviceSize offset, VkDeviceSize size); // expand a range to nonCoherentAtomSize
+
+		VkDevice device; // a handle for the logical device
+		VkPhysicalDeviceMemoryProperties memoryProperties; // a handle for the memory types and heaps
+		VkDeviceSize nonCoherentAtomSize; // a handle for the flush granularity of non-coherent memory
+		VkDeviceSize blockSize; // a handle for the preferred block size
+		std::vector<Pool> pools = {}; // a handle for the pools, two per memory type: linear then optimal
+		uint32_t dedicatedCount = 0; // a handle for the number of dedicated allocations
+		VkDeviceSize dedicatedBytes = 0; // a handle for the bytes in dedicated allocations
+		std::vector<VkDeviceSize> heapBytes = {}; // a handle for the bytes held on each heap
+		std::mutex mutex; // guards the pools, so resources can be created from any thread
+	};
+}
\ No newline at end of file
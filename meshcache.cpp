@@ -0,0 +1,204 @@
+#include "meshcache.hpp"
+#include "mappedfile.hpp"
+#include "utils.hpp"
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace ToyBox {
+	namespace {
+		// on-disk header, followed by the vertex and index arrays at the recorded offsets
+		struct CacheHeader {
+			uint32_t magic;
+			uint32_t version;
+			uint32_t vertexStride; // sizeof(Model::Vertex) when the cache was written
+			uint32_t indexStride; // sizeof(uint32_t)
+			uint64_t vertexCount;
+			uint64_t indexCount;
+			uint64_t vertexOffset; // byte offset of the vertex array from the start of the file
+			uint64_t indexOffset; // byte offset of the index array from the start of the file
+			uint64_t lodCount;
+			uint64_t lodOffset; // byte offset of the Model::Lod array from the start of the file
+			uint64_t meshletCount;
+			uint64_t meshletOffset; // byte offset of the Model::Meshlet array from the start of the file
+			uint64_t sourceSize;
+			int64_t sourceModifiedTime;
+			uint64_t sourceHash;
+			float boundsMin[3];
+			float boundsMax[3];
+		};
+		static_assert(sizeof(CacheHeader) == 128, "mesh cache header must have a fixed size");
+		static_assert(std::is_trivially_copyable<Model::Vertex>::value, "vertices are copied straight out of the mapping");
+
+		constexpr uint64_t DATA_ALIGNMENT = 16;
+
+		uint64_t alignOffset(uint64_t offset) {
+			return (offset + DATA_ALIGNMENT - 1) & ~(DATA_ALIGNMENT - 1);
+		}
+
+		// whether count elements of stride bytes at offset lie inside a file of size bytes, without the sum wrapping around
+		bool fitsInFile(uint64_t offset, uint64_t count, uint64_t stride, uint64_t size) {
+			return offset <= size && count <= (size - offset) / stride;
+		}
+
+		// a temporary file name no other process or loader thread writing the same cache uses
+		std::string makeTempPath(const std::string& cachePath) {
+#ifdef _WIN32
+			const uint64_t processId = static_cast<uint64_t>(_getpid());
+#else
+			const uint64_t processId = static_cast<uint64_t>(getpid());
+#endif
+			const uint64_t threadId = static_cast<uint64_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+			return cachePath + "." + std::to_string(processId) + "." + std::to_string(threadId) + ".tmp";
+		}
+	}
+
+	std::string MeshCache::getCachePath(const std::string& sourcePath) {
+		return sourcePath + ".tbmesh";
+	}
+
+	bool MeshCache::readSourceStamp(const std::string& sourcePath, SourceStamp& stamp) {
+		std::error_code error;
+		stamp.size = std::filesystem::file_size(sourcePath, error);
+		if (error) return false;
+
+		auto modified = std::filesystem::last_write_time(sourcePath, error);
+		if (error) return false;
+		stamp.modifiedTime = static_cast<int64_t>(modified.time_since_epoch().count());
+		return true;
+	}
+
+	uint64_t MeshCache::hashSource(const std::string& sourcePath) {
+		MappedFile source{ sourcePath };
+		return hashBytes(source.data(), source.size());
+	}
+
+	bool MeshCache::load(const std::string& sourcePath, Model::Builder& builder) {
+		const std::string cachePath = getCachePath(sourcePath);
+		std::error_code error;
+		if (!std::filesystem::exists(cachePath, error)) return false;
+
+		bool refreshStamp = false;
+		SourceStamp source = {};
+
+		try {
+			MappedFile cache{ cachePath };
+			if (cache.size() < sizeof(CacheHeader)) return false;
+
+			CacheHeader header;
+			std::memcpy(&header, cache.data(), sizeof(header));
+
+			// reject caches from another version of the format or vertex layout
+			if (header.magic != MAGIC || header.version != VERSION) return false;
+			if (header.vertexStride != sizeof(Model::Vertex) || header.indexStride != sizeof(uint32_t)) return false;
+			if (!fitsInFile(header.vertexOffset, header.vertexCount, sizeof(Model::Vertex), cache.size())) return false;
+			if (!fitsInFile(header.indexOffset, header.indexCount, sizeof(uint32_t), cache.size())) return false;
+			if (!fitsInFile(header.lodOffset, header.lodCount, sizeof(Model::Lod), cache.size())) return false;
+			if (!fitsInFile(header.meshletOffset, header.meshletCount, sizeof(Model::Meshlet), cache.size())) return false;
+
+			// the modification time is checked first since it is free, the content hash only when the time differs
+			// (for example after a fresh checkout), in which case an unchanged source keeps its cache
+			if (readSourceStamp(sourcePath, source)) {
+				if (source.size != header.sourceSize) return false;
+				if (source.modifiedTime != header.sourceModifiedTime) {
+					source.contentHash = hashSource(sourcePath);
+					if (source.contentHash != header.sourceHash) return false;
+					refreshStamp = true;
+				}
+			}
+
+			// read straight from the mapping, there is nothing to parse
+			const auto* vertices = reinterpret_cast<const Model::Vertex*>(cache.data() + header.vertexOffset);
+			const auto* indices = reinterpret_cast<const uint32_t*>(cache.data() + header.indexOffset);
+			const auto* lods = reinterpret_cast<const Model::Lod*>(cache.data() + header.lodOffset);
+			builder.vertices.assign(vertices, vertices + header.vertexCount);
+			builder.indices.assign(indices, indices + header.indexCount);
+			const auto* meshlets = reinterpret_cast<const Model::Meshlet*>(cache.data() + header.meshletOffset);
+			builder.lods.assign(lods, lods + header.lodCount);
+			builder.meshlets.assign(meshlets, meshlets + header.meshletCount);
+			builder.boundsMin = { header.boundsMin[0], header.boundsMin[1], header.boundsMin[2] };
+			builder.boundsMax = { header.boundsMax[0], header.boundsMax[1], header.boundsMax[2] };
+		}
+		catch (const std::exception&) {
+			return false;
+		}
+
+		// record the new modification time so the next load can skip hashing again
+		if (refreshStamp) {
+			std::fstream file{ cachePath, std::ios::in | std::ios::out | std::ios::binary };
+			if (file.is_open()) {
+				file.seekp(offsetof(CacheHeader, sourceModifiedTime));
+				file.write(reinterpret_cast<const char*>(&source.modifiedTime), sizeof(source.modifiedTime));
+			}
+		}
+
+		return true;
+	}
+
+	void MeshCache::store(const std::string& sourcePath, const Model::Builder& builder) {
+		SourceStamp source = {};
+		if (!readSourceStamp(sourcePath, source)) {
+			throw std::runtime_error("failed to read source model: " + sourcePath);
+		}
+		source.contentHash = hashSource(sourcePath);
+
+		CacheHeader header = {};
+		header.magic = MAGIC;
+		header.version = VERSION;
+		header.vertexStride = sizeof(Model::Vertex);
+		header.indexStride = sizeof(uint32_t);
+		header.vertexCount = builder.vertices.size();
+		header.indexCount = builder.indices.size();
+		header.vertexOffset = alignOffset(sizeof(CacheHeader));
+		header.indexOffset = alignOffset(header.vertexOffset + header.vertexCount * sizeof(Model::Vertex));
+		header.lodCount = builder.lods.size();
+		header.lodOffset = alignOffset(header.indexOffset + header.indexCount * sizeof(uint32_t));
+		header.meshletCount = builder.meshlets.size();
+		header.meshletOffset = alignOffset(header.lodOffset + header.lodCount * sizeof(Model::Lod));
+		header.sourceSize = source.size;
+		header.sourceModifiedTime = source.modifiedTime;
+		header.sourceHash = source.contentHash;
+		for (int i = 0; i < 3; i++) {
+			header.boundsMin[i] = builder.boundsMin[i];
+			header.boundsMax[i] = builder.boundsMax[i];
+		}
+
+		// write to a temporary file first so a partially written cache is never picked up; its name is unique to the writer
+		// since several loader threads may store the same model at once
+		const std::string cachePath = getCachePath(sourcePath);
+		const std::string tempPath = makeTempPath(cachePath);
+		{
+			std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+			if (!file.is_open()) {
+				throw std::runtime_error("failed to create mesh cache: " + tempPath);
+			}
+
+			const char padding[DATA_ALIGNMENT] = {};
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(padding, header.vertexOffset - sizeof(header));
+			file.write(reinterpret_cast<const char*>(builder.vertices.data()), header.vertexCount * sizeof(Model::Vertex));
+			file.write(padding, header.indexOffset - (header.vertexOffset + header.vertexCount * sizeof(Model::Vertex)));
+			file.write(reinterpret_cast<const char*>(builder.indices.data()), header.indexCount * sizeof(uint32_t));
+			file.write(padding, header.lodOffset - (header.indexOffset + header.indexCount * sizeof(uint32_t)));
+			file.write(reinterpret_cast<const char*>(builder.lods.data()), header.lodCount * sizeof(Model::Lod));
+			file.write(padding, header.meshletOffset - (header.lodOffset + header.lodCount * sizeof(Model::Lod)));
+			file.write(reinterpret_cast<const char*>(builder.meshlets.data()), header.meshletCount * sizeof(Model::Meshlet));
+
+			if (!file) {
+				throw std::runtime_error("failed to write mesh cache: " + tempPath);
+			}
+		}
+
+		std::filesystem::rename(tempPath, cachePath);
+	}
+}
\ No newline at end of file
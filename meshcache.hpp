@@ -0,0 +1,33 @@
+#pragma once
+#include "model.hpp"
+#include <cstdint>
+#include <string>
+
+namespace ToyBox {
+	// versioned binary mesh format written next to a source model and memory-mapped on later loads
+	// layout: header, packed Model::Vertex array, uint32_t index array, Model::Lod and Model::Meshlet arrays (each array aligned to 16 bytes)
+	class MeshCache {
+	public:
+		static constexpr uint32_t MAGIC = 0x48534d54; // "TMSH" when read as little endian bytes
+		static constexpr uint32_t VERSION = 4; // bump whenever the layout or Model::Vertex changes
+
+		static std::string getCachePath(const std::string& sourcePath); // the cache file that belongs to a source model
+
+		// fill the builder from the cache, returns false if the cache is missing, corrupt or older than the source
+		static bool load(const std::string& sourcePath, Model::Builder& builder);
+
+		// write the builder contents to the cache, stamped with the source's size, modification time and content hash
+		static void store(const std::string& sourcePath, const Model::Builder& builder);
+
+	private:
+		// identifies the version of the source model a cache was built from
+		struct SourceStamp {
+			uint64_t size = 0;
+			int64_t modifiedTime = 0;
+			uint64_t contentHash = 0;
+		};
+
+		static bool readSourceStamp(const std::string& sourcePath, SourceStamp& stamp); // size and modification time only
+		static uint64_t hashSource(const std::string& sourcePath); // hash the full contents of the source model
+	};
+}
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include "meshletbuilder.hpp"
+#include "meshoptimizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ToyBox {
+	std::vector<Model::Meshlet> MeshletBuilder::build(const std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices) {
+		std::vector<Model::Meshlet> meshlets = {};
+		const size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0) return meshlets;
+
+		MeshOptimizer::TriangleAdjacency adjacency = MeshOptimizer::buildAdjacency(indices, vertices.size());
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<uint32_t> vertexMeshlet(vertices.size(), std::numeric_limits<uint32_t>::max()); // the last meshlet that used each vertex
+		std::vector<uint32_t> meshletVertices = {};
+		std::vector<uint32_t> result = {};
+		result.reserve(indices.size());
+
+		// grow each meshlet from a seed triangle, always taking the neighbouring triangle that adds the fewest new vertices;
+		// seeds are taken in index order, which after the vertex cache pass keeps nearby meshlets next to each other
+		size_t seedCursor = 0;
+		while (true) {
+			while (seedCursor < triangleCount && emitted[seedCursor]) seedCursor++;
+			if (seedCursor == triangleCount) break;
+
+			const uint32_t meshletIndex = static_cast<uint32_t>(meshlets.size());
+			Model::Meshlet meshlet = {};
+			meshlet.firstIndex = static_cast<uint32_t>(result.size());
+			meshletVertices.clear();
+
+			auto newVertices = [&](size_t triangle) {
+				int count = 0;
+				for (int corner = 0; corner < 3; corner++) {
+					if (vertexMeshlet[indices[3 * triangle + corner]] != meshletIndex) count++;
+				}
+				return count;
+			};
+
+			size_t triangle = seedCursor;
+			while (true) {
+				emitted[triangle] = true;
+				for (int corner = 0; corner < 3; corner++) {
+					uint32_t vertex = indices[3 * triangle + corner];
+					if (vertexMeshlet[vertex] != meshletIndex) {
+						vertexMeshlet[vertex] = meshletIndex;
+						meshletVertices.push_back(vertex);
+					}
+					result.push_back(vertex);
+				}
+				meshlet.indexCount += 3;
+				if (meshlet.indexCount / 3 == MAX_TRIANGLES) break;
+
+				size_t best = triangleCount;
+				int bestNewVertices = 4;
+				for (uint32_t vertex : meshletVertices) {
+					for (uint32_t i = adjacency.offsets[vertex]; i < adjacency.offsets[vertex + 1]; i++) {
+						uint32_t candidate = adjacency.triangles[i];
+						if (emitted[candidate]) continue;
+						int count = newVertices(candidate);
+						if (count < bestNewVertices || (count == bestNewVertices && candidate < best)) {
+							bestNewVertices = count;
+							best = candidate;
+						}
+					}
+				}
+
+				// disconnected pieces (leaves, for example) continue with the next triangle in index order
+				if (best == triangleCount) {
+					while (seedCursor < triangleCount && emitted[seedCursor]) seedCursor++;
+					if (seedCursor == triangleCount) break;
+					best = seedCursor;
+					bestNewVertices = newVertices(best);
+				}
+
+				if (meshletVertices.size() + bestNewVertices > MAX_VERTICES) break;
+				triangle = best;
+			}
+
+			computeBounds(vertices, result.data() + meshlet.firstIndex, meshlet);
+			meshlets.push_back(meshlet);
+		}
+
+		indices.swap(result);
+		return meshlets;
+	}
+
+	void MeshletBuilder::computeBounds(const std::vector<Model::Vertex>& vertices, const uint32_t* indices, Model::Meshlet& meshlet) {
+		// sphere around the center of the bounding box, which is cheap and within a few percent of minimal for compact meshlets
+		glm::vec3 boundsMin{ std::numeric_limits<float>::max() };
+		glm::vec3 boundsMax{ std::numeric_limits<float>::lowest() };
+		for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+			boundsMin = glm::min(boundsMin, vertices[indices[i]].position);
+			boundsMax = glm::max(boundsMax, vertices[indices[i]].position);
+		}
+		meshlet.center = (boundsMin + boundsMax) * 0.5f;
+		meshlet.radius = 0.f;
+		for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+			meshlet.radius = std::max(meshlet.radius, glm::length(vertices[indices[i]].position - meshlet.center));
+		}
+
+		// the cone axis is the average face normal, and its spread is the widest angle between the axis and any face normal
+		glm::vec3 normalSum{ 0.f };
+		std::vector<glm::vec3> normals = {};
+		normals.reserve(meshlet.indexCount / 3);
+		for (uint32_t i = 0; i < meshlet.indexCount; i += 3) {
+			const glm::vec3& p0 = vertices[indices[i + 0]].position;
+			glm::vec3 normal = glm::cross(vertices[indices[i + 1]].position - p0, vertices[indices[i + 2]].position - p0);
+			float length = glm::length(normal);
+			if (length == 0.f) continue;
+			normals.push_back(normal / length);
+			normalSum += normals.back();
+		}
+
+		meshlet.coneAxis = {};
+		meshlet.coneCutoff = 1.f;
+		float axisLength = glm::length(normalSum);
+		if (normals.empty() || axisLength == 0.f) return;
+		meshlet.coneAxis = normalSum / axisLength;
+
+		float minDot = 1.f;
+		for (const auto& normal : normals) {
+			minDot = std::min(minDot, glm::dot(normal, meshlet.coneAxis));
+		}
+
+		// a cone of 90 degrees or wider always has a triangle facing the camera
+		if (minDot > 0.f) {
+			meshlet.coneCutoff = std::sqrt(1.f - minDot * minDot);
+		}
+	}
+
+	bool MeshletBuilder::isCulled(const Frustum& frustum, const glm::vec3& cameraPosition, const glm::vec3& center, float radius, const glm::vec3& coneAxis, float coneCutoff) {
+		if (!frustum.intersectsSphere(center, radius)) return true;
+
+		// every triangle is back facing when the whole bounding sphere lies inside the cone's back side
+		glm::vec3 toCenter = center - cameraPosition;
+		return glm::dot(toCenter, coneAxis) >= coneCutoff * glm::length(toCenter) + radius;
+	}
+}
\ No newline at end of file
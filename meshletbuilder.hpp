@@ -0,0 +1,25 @@
+#pragma once
+#include "camera.hpp"
+#include "model.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace ToyBox {
+	// splits a triangle list into meshlets of connected triangles and computes the culling data for each of them
+	class MeshletBuilder {
+	public:
+		static constexpr uint32_t MAX_VERTICES = 64;
+		static constexpr uint32_t MAX_TRIANGLES = 124;
+
+		// partition the triangles, rewriting indices so each meshlet is one contiguous range (offsets start at the list's first index)
+		static std::vector<Model::Meshlet> build(const std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices);
+
+		// bounding sphere and normal cone of the triangles in a meshlet's index range
+		static void computeBounds(const std::vector<Model::Vertex>& vertices, const uint32_t* indices, Model::Meshlet& meshlet);
+
+		// true when the meshlet is entirely outside the frustum or every triangle in it faces away from the camera;
+		// all arguments are in the same space (usually the meshlet transformed to world space); a cone cutoff of 1 leaves only the
+		// frustum test, for pipelines that draw back faces
+		static bool isCulled(const Frustum& frustum, const glm::vec3& cameraPosition, const glm::vec3& center, float radius, const glm::vec3& coneAxis, float coneCutoff);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,252 @@
+#include "meshoptimizer.hpp"
+#include <algorithm>
+#include <iostream>
+
+namespace ToyBox {
+	void MeshOptimizer::optimize(Model::Builder& builder) {
+		if (builder.indices.size() < 3 || builder.vertices.empty()) return;
+
+		CacheStats before = analyzeVertexCache(builder.indices, builder.vertices.size());
+
+		std::vector<uint32_t> clusters = optimizeVertexCache(builder.indices, builder.vertices.size());
+
+		// meshlets are carved out of the cache friendly order, which they scramble, so each is reordered again on its own and
+		// the overdraw pass moves them as whole clusters; the order measured below is the one that's cached and uploaded
+		builder.buildMeshlets();
+		if (!builder.meshlets.empty()) {
+			optimizeMeshlets(builder.indices, builder.meshlets);
+			clusters.clear();
+			for (const auto& meshlet : builder.meshlets) clusters.push_back(meshlet.firstIndex / 3);
+		}
+
+		std::vector<uint32_t> order = optimizeOverdraw(builder.indices, clusters, builder);
+		if (!builder.meshlets.empty() && !order.empty()) {
+			std::vector<Model::Meshlet> meshlets = {};
+			meshlets.reserve(builder.meshlets.size());
+			uint32_t firstIndex = builder.meshlets.front().firstIndex;
+			for (uint32_t cluster : order) {
+				meshlets.push_back(builder.meshlets[cluster]);
+				meshlets.back().firstIndex = firstIndex;
+				firstIndex += meshlets.back().indexCount;
+			}
+			builder.meshlets.swap(meshlets);
+		}
+		optimizeVertexFetch(builder.vertices, builder.indices);
+
+		CacheStats after = analyzeVertexCache(builder.indices, builder.vertices.size());
+		std::cout << "mesh optimizer: " << builder.indices.size() / 3 << " triangles, " << clusters.size() << " clusters, ACMR "
+			<< before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+	}
+
+	MeshOptimizer::TriangleAdjacency MeshOptimizer::buildAdjacency(const std::vector<uint32_t>& indices, size_t vertexCount) {
+		TriangleAdjacency adjacency = {};
+		adjacency.offsets.assign(vertexCount + 1, 0);
+		for (uint32_t index : indices) adjacency.offsets[index + 1]++;
+		for (size_t v = 0; v < vertexCount; v++) adjacency.offsets[v + 1] += adjacency.offsets[v];
+
+		std::vector<uint32_t> cursor(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+		adjacency.triangles.resize(indices.size());
+		for (size_t i = 0; i < indices.size(); i++) {
+			adjacency.triangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+		return adjacency;
+	}
+
+	MeshOptimizer::CacheStats MeshOptimizer::analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount) {
+		CacheStats stats = {};
+		if (indices.size() < 3 || vertexCount == 0) return stats;
+
+		// a vertex is in the fifo if it was pushed within the last CACHE_SIZE misses
+		std::vector<uint32_t> cacheTime(vertexCount, 0);
+		std::vector<bool> used(vertexCount, false);
+		uint32_t time = CACHE_SIZE + 1;
+		size_t misses = 0, uniqueVertices = 0;
+		for (uint32_t index : indices) {
+			if (time - cacheTime[index] > CACHE_SIZE) {
+				cacheTime[index] = time++;
+				misses++;
+			}
+			if (!used[index]) {
+				used[index] = true;
+				uniqueVertices++;
+			}
+		}
+
+		stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+		stats.atvr = static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+		return stats;
+	}
+
+	std::vector<uint32_t> MeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) {
+		// tipsify (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"):
+		// fan out from one vertex at a time and pick the next fanning vertex among the ones that are still in the cache
+		const size_t triangleCount = indices.size() / 3;
+		TriangleAdjacency adjacency = buildAdjacency(indices, vertexCount);
+
+		std::vector<uint32_t> liveTriangles(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++) liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+
+		std::vector<uint32_t> cacheTime(vertexCount, 0);
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<uint32_t> deadEnds = {}; // recently used vertices to fall back on when fanning runs out of candidates
+		std::vector<uint32_t> candidates = {};
+		std::vector<uint32_t> result = {};
+		std::vector<uint32_t> clusters = {};
+		result.reserve(indices.size());
+
+		uint32_t time = CACHE_SIZE + 1;
+		size_t scanCursor = 0; // next vertex to try when both the candidates and the dead-end stack are exhausted
+		while (scanCursor < vertexCount && liveTriangles[scanCursor] == 0) scanCursor++;
+		int64_t fanning = scanCursor < vertexCount ? static_cast<int64_t>(scanCursor) : -1;
+		if (fanning >= 0) clusters.push_back(0);
+
+		while (fanning >= 0) {
+			candidates.clear();
+			for (uint32_t i = adjacency.offsets[fanning]; i < adjacency.offsets[fanning + 1]; i++) {
+				uint32_t triangle = adjacency.triangles[i];
+				if (emitted[triangle]) continue;
+				emitted[triangle] = true;
+
+				for (int corner = 0; corner < 3; corner++) {
+					uint32_t vertex = indices[3 * triangle + corner];
+					result.push_back(vertex);
+					deadEnds.push_back(vertex);
+					candidates.push_back(vertex);
+					liveTriangles[vertex]--;
+					if (time - cacheTime[vertex] > CACHE_SIZE) {
+						cacheTime[vertex] = time++;
+					}
+				}
+			}
+
+			// prefer the candidate that will still be cached after emitting its remaining triangles, and among those the oldest
+			int64_t next = -1;
+			int64_t bestPriority = -1;
+			for (uint32_t vertex : candidates) {
+				if (liveTriangles[vertex] == 0) continue;
+				int64_t priority = 0;
+				if (time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= CACHE_SIZE) {
+					priority = time - cacheTime[vertex];
+				}
+				if (priority > bestPriority) {
+					bestPriority = priority;
+					next = vertex;
+				}
+			}
+
+			// dead end, so the next fan starts a new cluster
+			if (next < 0) {
+				while (!deadEnds.empty() && next < 0) {
+					uint32_t vertex = deadEnds.back();
+					deadEnds.pop_back();
+					if (liveTriangles[vertex] > 0) next = vertex;
+				}
+				while (next < 0 && scanCursor < vertexCount) {
+					if (liveTriangles[scanCursor] > 0) next = static_cast<int64_t>(scanCursor);
+					else scanCursor++;
+				}
+				if (next >= 0) clusters.push_back(static_cast<uint32_t>(result.size() / 3));
+			}
+			fanning = next;
+		}
+
+		indices.swap(result);
+		return clusters;
+	}
+
+	void MeshOptimizer::optimizeMeshlets(std::vector<uint32_t>& indices, const std::vector<Model::Meshlet>& meshlets) {
+		// each meshlet is renumbered to its own few vertices, so tipsify's tables stay meshlet sized
+		std::vector<uint32_t> local = {};
+		std::vector<uint32_t> globalVertices = {};
+		for (const auto& meshlet : meshlets) {
+			local.assign(indices.begin() + meshlet.firstIndex, indices.begin() + meshlet.firstIndex + meshlet.indexCount);
+			globalVertices.clear();
+			for (uint32_t& index : local) {
+				auto it = std::find(globalVertices.begin(), globalVertices.end(), index);
+				if (it == globalVertices.end()) it = globalVertices.insert(globalVertices.end(), index);
+				index = static_cast<uint32_t>(it - globalVertices.begin());
+			}
+
+			optimizeVertexCache(local, globalVertices.size());
+			for (size_t i = 0; i < local.size(); i++) {
+				indices[meshlet.firstIndex + i] = globalVertices[local[i]];
+			}
+		}
+	}
+
+	std::vector<uint32_t> MeshOptimizer::optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<uint32_t>& clusters, const Model::Builder& builder) {
+		if (clusters.size() < 2) return {};
+
+		const glm::vec3 meshCenter = (builder.boundsMin + builder.boundsMax) * 0.5f;
+		const size_t triangleCount = indices.size() / 3;
+
+		// score each cluster by how far out along its own average normal it sits, relative to the center of the mesh bounds;
+		// clusters on the outer shell facing outward get drawn first so the inner surfaces mostly fail the depth test
+		struct ClusterOrder {
+			float score;
+			uint32_t cluster;
+		};
+		std::vector<ClusterOrder> order(clusters.size());
+		for (size_t c = 0; c < clusters.size(); c++) {
+			const size_t begin = clusters[c];
+			const size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+			glm::vec3 centroid{ 0.f };
+			glm::vec3 normal{ 0.f };
+			float area = 0.f;
+			for (size_t t = begin; t < end; t++) {
+				const glm::vec3& p0 = builder.vertices[indices[3 * t + 0]].position;
+				const glm::vec3& p1 = builder.vertices[indices[3 * t + 1]].position;
+				const glm::vec3& p2 = builder.vertices[indices[3 * t + 2]].position;
+				glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+				float triangleArea = glm::length(cross);
+				centroid += (p0 + p1 + p2) * (triangleArea / 3.f);
+				normal += cross;
+				area += triangleArea;
+			}
+
+			float score = 0.f;
+			float normalLength = glm::length(normal);
+			if (area > 0.f && normalLength > 0.f) {
+				score = glm::dot(centroid / area - meshCenter, normal / normalLength);
+			}
+			order[c] = { score, static_cast<uint32_t>(c) };
+		}
+
+		std::stable_sort(order.begin(), order.end(), [](const ClusterOrder& a, const ClusterOrder& b) { return a.score > b.score; });
+
+		std::vector<uint32_t> result = {};
+		result.reserve(indices.size());
+		for (const auto& entry : order) {
+			const size_t begin = clusters[entry.cluster];
+			const size_t end = entry.cluster + 1 < clusters.size() ? clusters[entry.cluster + 1] : triangleCount;
+			result.insert(result.end(), indices.begin() + 3 * begin, indices.begin() + 3 * end);
+		}
+		indices.swap(result);
+
+		std::vector<uint32_t> clusterOrder(order.size());
+		for (size_t i = 0; i < order.size(); i++) clusterOrder[i] = order[i].cluster;
+		return clusterOrder;
+	}
+
+	void MeshOptimizer::optimizeVertexFetch(std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices) {
+		constexpr uint32_t unassigned = UINT32_MAX;
+		std::vector<uint32_t> remap(vertices.size(), unassigned);
+		std::vector<Model::Vertex> result = {};
+		result.reserve(vertices.size());
+
+		for (uint32_t& index : indices) {
+			if (remap[index] == unassigned) {
+				remap[index] = static_cast<uint32_t>(result.size());
+				result.push_back(vertices[index]);
+			}
+			index = remap[index];
+		}
+
+		// vertices no index refers to are kept at the end so the vertex count does not change
+		for (size_t v = 0; v < vertices.size(); v++) {
+			if (remap[v] == unassigned) result.push_back(vertices[v]);
+		}
+		vertices.swap(result);
+	}
+}
\ No newline at end of file
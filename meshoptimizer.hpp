@@ -0,0 +1,41 @@
+#pragma once
+#include "model.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace ToyBox {
+	// reorders a builder's triangles and vertices so the gpu does less work drawing them:
+	// post-transform vertex cache reuse first, then meshlets for large meshes, then overdraw, then vertex fetch locality
+	class MeshOptimizer {
+	public:
+		static constexpr uint32_t CACHE_SIZE = 16; // simulated fifo post-transform cache size, in vertices
+
+		// vertex cache statistics for an index list
+		struct CacheStats {
+			float acmr = 0.f; // average cache miss ratio, transformed vertices per triangle (0.5 is the ideal for large grids, 3 the worst)
+			float atvr = 0.f; // average transform to vertex ratio, transformed vertices per unique vertex (1 is the ideal)
+		};
+
+		// for every vertex, the triangles that use it (compressed into one offsets array and one triangle array)
+		struct TriangleAdjacency {
+			std::vector<uint32_t> offsets = {};
+			std::vector<uint32_t> triangles = {};
+		};
+
+		static void optimize(Model::Builder& builder); // run every pass, building the meshlets, and print the cache statistics of the final order
+		static CacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount);
+		static TriangleAdjacency buildAdjacency(const std::vector<uint32_t>& indices, size_t vertexCount);
+
+		// reorder triangles for vertex cache reuse (tipsify), returns the first triangle of every cluster it produced
+		static std::vector<uint32_t> optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+		// reorder the triangles within each meshlet for vertex cache reuse, the meshlets keep their ranges
+		static void optimizeMeshlets(std::vector<uint32_t>& indices, const std::vector<Model::Meshlet>& meshlets);
+
+		// reorder the clusters so the ones facing away from the mesh center are drawn first and occlude the rest, returns the clusters in their new order
+		static std::vector<uint32_t> optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<uint32_t>& clusters, const Model::Builder& builder);
+
+		// reorder the vertices in the order the index list first references them and remap the indices
+		static void optimizeVertexFetch(std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices);
+	};
+}
\ No newline at end of file
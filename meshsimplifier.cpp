@@ -0,0 +1,254 @@
+#include "meshsimplifier.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+
+namespace ToyBox {
+	namespace {
+		constexpr double BORDER_WEIGHT = 10.0; // how strongly open edges resist moving compared to the surface itself
+
+		// symmetric 4x4 quadric, stored as the upper triangle of A plus b and c so that error(p) = p'Ap + 2b'p + c
+		struct Quadric {
+			double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+			double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+			double c = 0.0;
+			double weight = 0.0;
+
+			void addPlane(const glm::vec3& normal, float distance, double planeWeight) {
+				const double x = normal.x, y = normal.y, z = normal.z, d = distance;
+				a00 += planeWeight * x * x; a01 += planeWeight * x * y; a02 += planeWeight * x * z;
+				a11 += planeWeight * y * y; a12 += planeWeight * y * z; a22 += planeWeight * z * z;
+				b0 += planeWeight * x * d; b1 += planeWeight * y * d; b2 += planeWeight * z * d;
+				c += planeWeight * d * d;
+				weight += planeWeight;
+			}
+
+			void add(const Quadric& other) {
+				a00 += other.a00; a01 += other.a01; a02 += other.a02;
+				a11 += other.a11; a12 += other.a12; a22 += other.a22;
+				b0 += other.b0; b1 += other.b1; b2 += other.b2;
+				c += other.c;
+				weight += other.weight;
+			}
+
+			// weighted mean of the squared distances from p to every plane in the quadric
+			double error(const glm::vec3& p) const {
+				const double x = p.x, y = p.y, z = p.z;
+				double result = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z);
+				result += 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+				return weight > 0.0 ? std::max(result, 0.0) / weight : 0.0;
+			}
+		};
+
+		struct Collapse {
+			double cost;
+			uint32_t from;
+			uint32_t to;
+			uint32_t fromVersion;
+			uint32_t toVersion;
+			bool operator>(const Collapse& other) const { return cost > other.cost; }
+		};
+
+		uint64_t edgeKey(uint32_t a, uint32_t b) {
+			return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+		}
+
+		// how different two vertices sharing a position are, used to keep uv and normal seams when a position moves
+		float attributeDistance(const Model::Vertex& a, const Model::Vertex& b) {
+			glm::vec3 normal = a.normal - b.normal;
+			glm::vec3 color = a.color - b.color;
+			glm::vec2 uv = a.uv - b.uv;
+			return glm::dot(normal, normal) + glm::dot(color, color) + glm::dot(uv, uv);
+		}
+	}
+
+	float MeshSimplifier::simplify(const std::vector<Model::Vertex>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount, float targetError, std::vector<uint32_t>& result) {
+		result = indices;
+		const size_t triangleCount = indices.size() / 3;
+		if (indices.size() <= targetIndexCount || triangleCount == 0) return 0.f;
+
+		// weld vertices that share a position, the simplifier moves positions and carries every vertex (wedge) on them along
+		std::unordered_map<glm::vec3, uint32_t> positionIds = {};
+		std::vector<uint32_t> positionOf(vertices.size());
+		std::vector<glm::vec3> positions = {};
+		std::vector<std::vector<uint32_t>> wedges = {};
+		for (uint32_t v = 0; v < vertices.size(); v++) {
+			auto inserted = positionIds.emplace(vertices[v].position, static_cast<uint32_t>(positions.size()));
+			if (inserted.second) {
+				positions.push_back(vertices[v].position);
+				wedges.emplace_back();
+			}
+			positionOf[v] = inserted.first->second;
+			wedges[positionOf[v]].push_back(v);
+		}
+		const size_t positionCount = positions.size();
+
+		// triangles around each position, plus the face quadrics weighted by area
+		std::vector<std::vector<uint32_t>> positionTriangles(positionCount);
+		std::vector<Quadric> quadrics(positionCount);
+		std::unordered_map<uint64_t, uint32_t> edgeUses = {};
+		edgeUses.reserve(indices.size());
+		for (uint32_t t = 0; t < triangleCount; t++) {
+			uint32_t p[3] = { positionOf[indices[3 * t + 0]], positionOf[indices[3 * t + 1]], positionOf[indices[3 * t + 2]] };
+			for (int corner = 0; corner < 3; corner++) {
+				positionTriangles[p[corner]].push_back(t);
+				edgeUses[edgeKey(p[corner], p[(corner + 1) % 3])]++;
+			}
+
+			glm::vec3 normal = glm::cross(positions[p[1]] - positions[p[0]], positions[p[2]] - positions[p[0]]);
+			float doubleArea = glm::length(normal);
+			if (doubleArea == 0.f) continue;
+			normal /= doubleArea;
+			float distance = -glm::dot(normal, positions[p[0]]);
+			for (int corner = 0; corner < 3; corner++) {
+				quadrics[p[corner]].addPlane(normal, distance, doubleArea * 0.5);
+			}
+		}
+
+		// open edges get a plane perpendicular to their face so the silhouette of the mesh doesn't shrink
+		for (uint32_t t = 0; t < triangleCount; t++) {
+			uint32_t p[3] = { positionOf[indices[3 * t + 0]], positionOf[indices[3 * t + 1]], positionOf[indices[3 * t + 2]] };
+			glm::vec3 faceNormal = glm::cross(positions[p[1]] - positions[p[0]], positions[p[2]] - positions[p[0]]);
+			if (glm::length(faceNormal) == 0.f) continue;
+			faceNormal = glm::normalize(faceNormal);
+
+			for (int corner = 0; corner < 3; corner++) {
+				uint32_t a = p[corner], b = p[(corner + 1) % 3];
+				if (edgeUses[edgeKey(a, b)] != 1) continue;
+				glm::vec3 edge = positions[b] - positions[a];
+				float edgeLength = glm::length(edge);
+				if (edgeLength == 0.f) continue;
+				glm::vec3 normal = glm::normalize(glm::cross(edge, faceNormal));
+				float distance = -glm::dot(normal, positions[a]);
+				quadrics[a].addPlane(normal, distance, BORDER_WEIGHT * edgeLength * edgeLength);
+				quadrics[b].addPlane(normal, distance, BORDER_WEIGHT * edgeLength * edgeLength);
+			}
+		}
+
+		std::vector<uint32_t> version(positionCount, 0);
+		std::vector<bool> alive(positionCount, true);
+		std::vector<bool> removed(triangleCount, false);
+		size_t liveTriangles = triangleCount;
+
+		// cheapest direction for collapsing an edge, measured against the sum of both endpoint quadrics
+		auto evaluate = [&](uint32_t a, uint32_t b) {
+			Quadric merged = quadrics[a];
+			merged.add(quadrics[b]);
+			double costToB = merged.error(positions[b]);
+			double costToA = merged.error(positions[a]);
+			if (costToB <= costToA) return Collapse{ costToB, a, b, version[a], version[b] };
+			return Collapse{ costToA, b, a, version[b], version[a] };
+		};
+
+		std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> collapses = {};
+		for (const auto& edge : edgeUses) {
+			uint32_t a = static_cast<uint32_t>(edge.first >> 32), b = static_cast<uint32_t>(edge.first & 0xffffffffu);
+			if (a != b) collapses.push(evaluate(a, b));
+		}
+		edgeUses.clear();
+
+		const double maxCost = static_cast<double>(targetError) * targetError;
+		double largestCost = 0.0;
+		std::vector<uint32_t> neighbours = {};
+		std::vector<uint32_t> wedgeMap = {};
+
+		while (liveTriangles * 3 > targetIndexCount && !collapses.empty()) {
+			Collapse collapse = collapses.top();
+			collapses.pop();
+			if (collapse.cost > maxCost) break;
+
+			// skip entries that went stale when an endpoint was collapsed or its neighbourhood changed
+			const uint32_t from = collapse.from, to = collapse.to;
+			if (!alive[from] || !alive[to] || version[from] != collapse.fromVersion || version[to] != collapse.toVersion) continue;
+
+			// reject collapses that would fold a surviving triangle over
+			bool flips = false;
+			for (uint32_t t : positionTriangles[from]) {
+				if (removed[t]) continue;
+				uint32_t p[3] = { positionOf[result[3 * t + 0]], positionOf[result[3 * t + 1]], positionOf[result[3 * t + 2]] };
+				if (p[0] == to || p[1] == to || p[2] == to) continue;
+
+				glm::vec3 before = glm::cross(positions[p[1]] - positions[p[0]], positions[p[2]] - positions[p[0]]);
+				for (int corner = 0; corner < 3; corner++) {
+					if (p[corner] == from) p[corner] = to;
+				}
+				glm::vec3 after = glm::cross(positions[p[1]] - positions[p[0]], positions[p[2]] - positions[p[0]]);
+				if (glm::dot(before, after) <= 0.f) {
+					flips = true;
+					break;
+				}
+			}
+			if (flips) continue;
+
+			// every vertex on the collapsed position moves to the most similar vertex on the target position
+			wedgeMap.clear();
+			for (uint32_t wedge : wedges[from]) {
+				uint32_t best = wedges[to][0];
+				float bestDistance = std::numeric_limits<float>::max();
+				for (uint32_t candidate : wedges[to]) {
+					float distance = attributeDistance(vertices[wedge], vertices[candidate]);
+					if (distance < bestDistance) {
+						bestDistance = distance;
+						best = candidate;
+					}
+				}
+				wedgeMap.push_back(best);
+			}
+
+			for (uint32_t t : positionTriangles[from]) {
+				if (removed[t]) continue;
+				for (int corner = 0; corner < 3; corner++) {
+					uint32_t& index = result[3 * t + corner];
+					if (positionOf[index] != from) continue;
+					size_t wedge = std::find(wedges[from].begin(), wedges[from].end(), index) - wedges[from].begin();
+					index = wedgeMap[wedge];
+				}
+
+				uint32_t p0 = positionOf[result[3 * t + 0]], p1 = positionOf[result[3 * t + 1]], p2 = positionOf[result[3 * t + 2]];
+				if (p0 == p1 || p1 == p2 || p0 == p2) {
+					removed[t] = true;
+					liveTriangles--;
+				}
+				else {
+					positionTriangles[to].push_back(t);
+				}
+			}
+
+			alive[from] = false;
+			positionTriangles[from] = {};
+			quadrics[to].add(quadrics[from]);
+			version[to]++;
+			largestCost = std::max(largestCost, collapse.cost);
+
+			// drop the dead triangles around the target and requeue its edges with the merged quadric
+			auto& around = positionTriangles[to];
+			around.erase(std::remove_if(around.begin(), around.end(), [&](uint32_t t) { return removed[t]; }), around.end());
+			neighbours.clear();
+			for (uint32_t t : around) {
+				for (int corner = 0; corner < 3; corner++) {
+					uint32_t p = positionOf[result[3 * t + corner]];
+					if (p != to) neighbours.push_back(p);
+				}
+			}
+			std::sort(neighbours.begin(), neighbours.end());
+			neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+			for (uint32_t neighbour : neighbours) {
+				collapses.push(evaluate(to, neighbour));
+			}
+		}
+
+		// compact the surviving triangles, keeping their relative order
+		size_t write = 0;
+		for (size_t t = 0; t < triangleCount; t++) {
+			if (removed[t]) continue;
+			for (int corner = 0; corner < 3; corner++) {
+				result[write++] = result[3 * t + corner];
+			}
+		}
+		result.resize(write);
+
+		return static_cast<float>(std::sqrt(largestCost));
+	}
+}
\ No newline at end of file
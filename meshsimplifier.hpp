@@ -0,0 +1,15 @@
+#pragma once
+#include "model.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace ToyBox {
+	// quadric error metric edge-collapse simplification (Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics");
+	// edges collapse onto one of their endpoints, so the simplified index list keeps indexing the original vertex array
+	class MeshSimplifier {
+	public:
+		// collapse edges until at most targetIndexCount indices remain or the cheapest collapse would exceed targetError;
+		// errors are distances in model units, and the largest error any collapse introduced is returned
+		static float simplify(const std::vector<Model::Vertex>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount, float targetError, std::vector<uint32_t>& result);
+	};
+}
\ No newline at end of file
@@ -1,95 +1,179 @@
 #include "model.hpp"
-#include "utils.hpp"
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
+#include "meshcache.hpp"
+#include "meshletbuilder.hpp"
+#include "meshoptimizer.hpp"
+#include "meshsimplifier.hpp"
+#include "vertexquantizer.hpp"
+#include "objloader.hpp"
+#include <algorithm>
 #include <cassert>
-#include <unordered_map>
+#include <iostream>
+#include <limits>
+#include <sstream>
 
-namespace std {
-	template <>
-	struct hash<ToyBox::Model::Vertex> {
-		size_t operator()(ToyBox::Model::Vertex const& vertex) const {
-			size_t seed = 0;
-			ToyBox::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-			return seed;
+namespace ToyBox {
+	Model::Model(Device& device, const Model::Builder& builder) : device{ device }, vertexFormat{ builder.vertexFormat } {
+		// the vertex and index bytes stay on the host as well, so an evicted model can be streamed back in
+		if (vertexFormat == VertexFormat::Packed) {
+			std::vector<PackedVertex> packedVertices = {};
+			VertexQuantizer::QuantizationError error = {};
+			positionDequantization = VertexQuantizer::pack(builder, packedVertices, error);
+			std::cout << "vertex quantizer: " << packedVertices.size() << " vertices, " << sizeof(Vertex) << " -> " << sizeof(PackedVertex)
+				<< " bytes each, max error: position " << error.position << ", normal " << error.normal << " deg, color " << error.color
+				<< ", uv " << error.uv << std::endl;
+			setVertices(packedVertices.data(), sizeof(PackedVertex), static_cast<uint32_t>(packedVertices.size()));
+		}
+		else {
+			setVertices(builder.vertices.data(), sizeof(Vertex), static_cast<uint32_t>(builder.vertices.size()));
 		}
-	};
-}
+		setIndices(builder.indices);
 
-namespace ToyBox {
-	Model::Model(Device& device, const Model::Builder& builder) : device{ device } {
-		createVertexBuffers(builder.vertices);
-		createIndexBuffer(builder.indices);
+		lods = builder.lods;
+		if (lods.empty()) lods.push_back({ 0, indexCount, 0.f });
+		boundsMin = builder.boundsMin;
+		boundsMax = builder.boundsMax;
+		boundsCenter = (builder.boundsMin + builder.boundsMax) * 0.5f;
+		boundsRadius = glm::length(builder.boundsMax - builder.boundsMin) * 0.5f;
+		meshlets = builder.meshlets;
+
+		upload();
 	}
 
-	Model::~Model() {}
+	Model::~Model() {
+		release();
+	}
 
-	std::unique_ptr<Model> Model::createModelFromFile(Device& device, const std::string& filepath) {
+	std::unique_ptr<Model> Model::createModelFromFile(Device& device, const std::string& filepath, VertexFormat vertexFormat) {
 		Builder builder = {};
 		builder.loadModel(filepath);
-		return std::make_unique<Model>(device, builder);
+		builder.vertexFormat = vertexFormat;
+		auto model = std::make_unique<Model>(device, builder);
+		device.getUploadBatcher().wait(model->getUploadBatch());
+		return model;
+	}
+
+	void Model::evict() {
+		if (evicted) return;
+		release();
+		evicted = true;
 	}
 
-	void Model::createVertexBuffers(const std::vector<Vertex>& vertices) {
+	void Model::restream() {
+		if (!evicted) return;
+		upload();
+		evicted = false;
+	}
+
+	VkDeviceSize Model::getDeviceBytes() const {
+		return hostVertices.size() + hostIndices.size() + meshlets.size() * sizeof(Meshlet);
+	}
+
+	void Model::setVertices(const void* vertexData, uint32_t size, uint32_t count) {
 		// check that we have at least one triangle (3 vertices)
-		vertexCount = static_cast<uint32_t>(vertices.size());
+		vertexCount = count;
+		vertexSize = size;
 		assert(vertexCount >= 3 && "Vertex count must be at least 3");
 
-		// create a staging buffer
-		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
-		uint32_t vertexSize = sizeof(vertices[0]);
-		Buffer stagingBuffer{ device, vertexSize, vertexCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
-		
-		// map the staging buffer memory
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer((void*)vertices.data());
-
-		// create a vertex buffer
-		vertexBuffer = std::make_unique<Buffer>(device, vertexSize, vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		device.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+		const char* bytes = static_cast<const char*>(vertexData);
+		hostVertices.assign(bytes, bytes + static_cast<size_t>(vertexSize) * vertexCount);
 	}
 
-	void Model::createIndexBuffer(const std::vector<uint32_t>& indices) {
+	void Model::setIndices(const std::vector<uint32_t>& indices) {
 		// check that we are using an index buffer for rendering
 		indexCount = static_cast<uint32_t>(indices.size());
 		hasIndexBuffer = indexCount > 0;
 		if (!hasIndexBuffer) return;
 
-		// create a staging buffer
-		VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
-		uint32_t indexSize = sizeof(indices[0]);
-		Buffer stagingBuffer{ device, indexSize, indexCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+		// store 16-bit indices whenever every vertex fits, which halves the index memory and bandwidth
+		// (0xffff is left unused so enabling primitive restart later can't change the meaning of an index)
+		if (vertexCount < std::numeric_limits<uint16_t>::max()) {
+			std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+			const char* bytes = reinterpret_cast<const char*>(shortIndices.data());
+			hostIndices.assign(bytes, bytes + shortIndices.size() * sizeof(uint16_t));
+			indexType = VK_INDEX_TYPE_UINT16;
+		}
+		else {
+			const char* bytes = reinterpret_cast<const char*>(indices.data());
+			hostIndices.assign(bytes, bytes + indices.size() * sizeof(uint32_t));
+			indexType = VK_INDEX_TYPE_UINT32;
+		}
+	}
 
-		// map the staging buffer memory
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer((void*)indices.data());
+	void Model::upload() {
+		// an allocation failing halfway must not leak the ranges already taken
+		try {
+			createVertexBuffers();
+			createIndexBuffer();
+			createMeshletBuffer();
+		}
+		catch (...) {
+			release();
+			throw;
+		}
+	}
+
+	void Model::release() {
+		// the gpu may still be copying into the ranges that are about to be handed out again
+		device.getUploadBatcher().wait(uploadBatch);
+		device.getGeometryArena().free(vertexAllocation);
+		device.getGeometryArena().free(indexAllocation);
+		meshletBuffer.reset();
+	}
+
+	void Model::createVertexBuffers() {
+		// reserve the vertices in the shared arena and queue their contents on the staging ring
+		GeometryArena& arena = device.getGeometryArena();
+		vertexAllocation = arena.allocateVertices(vertexSize, vertexCount);
+		uploadBatch = device.getUploadBatcher().upload(arena.getBuffer(vertexAllocation.pool), hostVertices.data(), hostVertices.size(), static_cast<VkDeviceSize>(vertexSize) * vertexAllocation.first);
+	}
+
+	void Model::createIndexBuffer() {
+		if (!hasIndexBuffer) return;
+
+		// reserve the indices in the shared arena and queue their contents on the staging ring;
+		// they stay relative to the model's first vertex, which the draws pass as the vertex offset
+		GeometryArena& arena = device.getGeometryArena();
+		VkDeviceSize indexSize = indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+		indexAllocation = arena.allocateIndices(indexType, indexCount);
+		uploadBatch = device.getUploadBatcher().upload(arena.getBuffer(indexAllocation.pool), hostIndices.data(), hostIndices.size(), indexSize * indexAllocation.first);
+	}
+
+	void Model::createMeshletBuffer() {
+		if (meshlets.empty()) return;
 
-		// create a vertex buffer
-		indexBuffer = std::make_unique<Buffer>(device, indexSize, indexCount, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		device.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
+		// create a storage buffer that culling shaders can read and queue its contents on the staging ring
+		uint32_t meshletSize = sizeof(Meshlet);
+		uint32_t meshletCount = static_cast<uint32_t>(meshlets.size());
+		VkDeviceSize bufferSize = static_cast<VkDeviceSize>(meshletSize) * meshletCount;
+		meshletBuffer = std::make_unique<Buffer>(device, meshletSize, meshletCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		uploadBatch = device.getUploadBatcher().upload(meshletBuffer->getBuffer(), meshlets.data(), bufferSize);
 	}
 
 	void Model::bind(VkCommandBuffer commandBuffer) {
-		VkBuffer buffers[] = { vertexBuffer->getBuffer() };
+		VkBuffer buffers[] = { getVertexBuffer() };
 		VkDeviceSize offsets[] = { 0 };
 		vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
 
 		if (hasIndexBuffer) {
-			vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+			vkCmdBindIndexBuffer(commandBuffer, getIndexBuffer(), 0, indexType);
 		}
 	}
 
-	void Model::draw(VkCommandBuffer commandBuffer) {
+	void Model::draw(VkCommandBuffer commandBuffer, uint32_t lod, uint32_t instanceCount, uint32_t firstInstance) {
 		if (hasIndexBuffer) {
-			vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+			assert(lod < lods.size() && "LOD index out of range");
+			vkCmdDrawIndexed(commandBuffer, lods[lod].indexCount, instanceCount, indexAllocation.first + lods[lod].firstIndex, static_cast<int32_t>(vertexAllocation.first), firstInstance);
 		}
 		else {
-			vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+			vkCmdDraw(commandBuffer, vertexCount, instanceCount, vertexAllocation.first, firstInstance);
 		}
 	}
 
+	void Model::drawRange(VkCommandBuffer commandBuffer, uint32_t firstIndex, uint32_t indexCount, uint32_t instanceCount, uint32_t firstInstance) {
+		assert(hasIndexBuffer && "Cannot draw an index range without an index buffer");
+		vkCmdDrawIndexed(commandBuffer, indexCount, instanceCount, indexAllocation.first + firstIndex, static_cast<int32_t>(vertexAllocation.first), firstInstance);
+	}
+
 	std::vector<VkVertexInputBindingDescription> Model::Vertex::getBindingDescriptions() {
 		std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
 		bindingDescriptions[0].binding = 0;
@@ -109,61 +193,106 @@ namespace ToyBox {
 		return attributeDescriptions;
 	}
 
+	std::vector<VkVertexInputBindingDescription> Model::PackedVertex::getBindingDescriptions() {
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+		bindingDescriptions[0].binding = 0;
+		bindingDescriptions[0].stride = sizeof(PackedVertex);
+		bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		return bindingDescriptions;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> Model::PackedVertex::getAttributeDescriptions() {
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions = {};
+
+		// same locations as Vertex, so simple_shader.frag works with both layouts
+		attributeDescriptions.push_back({ 0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(PackedVertex, position) });
+		attributeDescriptions.push_back({ 1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(PackedVertex, color) });
+		attributeDescriptions.push_back({ 2, 0, VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, normal) });
+		attributeDescriptions.push_back({ 3, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(PackedVertex, uv) });
+
+		return attributeDescriptions;
+	}
+
 	void Model::Builder::loadModel(const std::string& filepath) {
-		tinyobj::attrib_t attrib;
-		std::vector<tinyobj::shape_t> shapes;
-		std::vector<tinyobj::material_t> materials;
-		std::string warn, err;
-
-		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepath.c_str())) {
-			throw std::runtime_error(warn + err);
-		}
-
-		// start from a fresh builder state
-		vertices.clear();
-		indices.clear();
-
-		std::unordered_map<Vertex, uint32_t> uniqueVertices = {};
-
-		for (const auto& shape : shapes) {
-			for (const auto& index : shape.mesh.indices) {
-				Vertex vertex = {};
-
-				if (index.vertex_index >= 0) {
-					vertex.position = { 
-						attrib.vertices[3 * index.vertex_index + 0],
-						attrib.vertices[3 * index.vertex_index + 1],
-						attrib.vertices[3 * index.vertex_index + 2],
-					};
-
-					vertex.color = {
-						attrib.colors[3 * index.vertex_index + 0],
-						attrib.colors[3 * index.vertex_index + 1],
-						attrib.colors[3 * index.vertex_index + 2],
-					};
-				}
-
-				if (index.normal_index >= 0) {
-					vertex.normal = {
-						attrib.normals[3 * index.normal_index + 0],
-						attrib.normals[3 * index.normal_index + 1],
-						attrib.normals[3 * index.normal_index + 2],
-					};
-				}
-
-				if (index.texcoord_index >= 0) {
-					vertex.uv = {
-						attrib.texcoords[2 * index.texcoord_index + 0],
-						attrib.texcoords[2 * index.texcoord_index + 1],
-					};
-				}
-
-				if (uniqueVertices.count(vertex) == 0) {
-					uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-					vertices.push_back(vertex);
-				}
-				indices.push_back(uniqueVertices[vertex]);
-			}
+		if (MeshCache::load(filepath, *this)) return;
+
+		ObjLoader::load(filepath, *this);
+		computeBounds();
+		MeshOptimizer::optimize(*this); // optimized once here along with the meshlets, the cache stores the optimized order
+		generateLods();
+
+		// a missing cache only costs startup time, so failing to write one is not fatal
+		try {
+			MeshCache::store(filepath, *this);
+		}
+		catch (const std::exception& e) {
+			std::cerr << "mesh cache: " << e.what() << std::endl;
+		}
+	}
+
+	void Model::Builder::computeBounds() {
+		if (vertices.empty()) {
+			boundsMin = boundsMax = {};
+			return;
 		}
+
+		boundsMin = glm::vec3{ std::numeric_limits<float>::max() };
+		boundsMax = glm::vec3{ std::numeric_limits<float>::lowest() };
+		for (const auto& vertex : vertices) {
+			boundsMin = glm::min(boundsMin, vertex.position);
+			boundsMax = glm::max(boundsMax, vertex.position);
+		}
+	}
+
+	void Model::Builder::generateLods() {
+		constexpr size_t maxLodCount = 8;
+		constexpr size_t minTriangleCount = 64;
+		constexpr float maxErrorFraction = 0.05f; // no lod may stray further than this fraction of the mesh's diagonal
+
+		lods.clear();
+		if (indices.size() < 3 || vertices.empty()) return;
+		lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.f });
+
+		// each level halves the previous one; the errors of consecutive levels add up since each is measured against its parent
+		const float maxError = glm::length(boundsMax - boundsMin) * maxErrorFraction;
+		std::vector<uint32_t> previous = indices;
+		std::vector<uint32_t> simplified = {};
+		float error = 0.f;
+		while (lods.size() < maxLodCount && previous.size() / 3 > minTriangleCount) {
+			float levelError = MeshSimplifier::simplify(vertices, previous, previous.size() / 2, maxError - error, simplified);
+			if (simplified.size() * 10 > previous.size() * 9) break; // the error budget is spent
+
+			MeshOptimizer::optimizeVertexCache(simplified, vertices.size());
+			error += levelError;
+			lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(simplified.size()), error });
+			indices.insert(indices.end(), simplified.begin(), simplified.end());
+			previous.swap(simplified);
+		}
+
+		// built up first and written at once, models load on several threads and their lines would interleave
+		std::ostringstream report;
+		report << "lod chain: " << lods.size() << " levels";
+		for (const auto& lod : lods) {
+			report << ", " << lod.indexCount / 3 << " triangles (error " << lod.error << ")";
+		}
+		report << "\n";
+		std::cout << report.str() << std::flush;
+	}
+
+	void Model::Builder::buildMeshlets() {
+		constexpr size_t minTriangleCount = 8 * MeshletBuilder::MAX_TRIANGLES; // smaller meshes are culled as a whole
+
+		meshlets.clear();
+		const Lod fullDetail = lods.empty() ? Lod{ 0, static_cast<uint32_t>(indices.size()), 0.f } : lods[0];
+		if (fullDetail.indexCount / 3 < minTriangleCount) return;
+
+		std::vector<uint32_t> fullDetailIndices(indices.begin() + fullDetail.firstIndex, indices.begin() + fullDetail.firstIndex + fullDetail.indexCount);
+		meshlets = MeshletBuilder::build(vertices, fullDetailIndices);
+		std::copy(fullDetailIndices.begin(), fullDetailIndices.end(), indices.begin() + fullDetail.firstIndex);
+		for (auto& meshlet : meshlets) {
+			meshlet.firstIndex += fullDetail.firstIndex;
+		}
+
+		std::cout << "meshlets: " << meshlets.size() << " for " << fullDetail.indexCount / 3 << " triangles" << std::endl;
 	}
 }
\ No newline at end of file
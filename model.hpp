@@ -1,15 +1,27 @@
 #pragma once
 #include "device.hpp"
 #include "buffer.hpp"
+#include "uploadbatcher.hpp"
+#include "geometryarena.hpp"
+#include "utils.hpp"
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+#include <cstdint>
 #include <vector>
 #include <memory>
 
 namespace ToyBox {
 	class Model {
 	public:
+		// layout of the vertex data uploaded to the gpu
+		enum class VertexFormat {
+			Float, // Model::Vertex, 44 bytes of full precision floats
+			Packed, // Model::PackedVertex, 20 bytes quantized (needs the simple_shader_packed.vert variant)
+		};
+
 		// struct for vertex attributes to make them easier to work with
 		struct Vertex {
 			glm::vec3 position = {};
@@ -23,34 +35,126 @@ namespace ToyBox {
 			}
 		};
 
+		// compact vertex: position quantized to the mesh bounds, octahedral normal, half float uv and rgba8 color
+		struct PackedVertex {
+			uint16_t position[4] = {}; // unorm16 x, y, z within the mesh bounds (w is padding)
+			uint8_t color[4] = {}; // unorm8 r, g, b, a
+			int16_t normal[2] = {}; // snorm16 octahedral encoding of the unit normal
+			uint16_t uv[2] = {}; // half float u, v
+			static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+			static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+		};
+
+		// a level of detail: a range of the index buffer and how far (in model units) its surface strays from full detail
+		struct Lod {
+			uint32_t firstIndex = 0;
+			uint32_t indexCount = 0;
+			float error = 0.f;
+		};
+
+		// a cluster of up to MeshletBuilder::MAX_VERTICES vertices and MAX_TRIANGLES triangles of the full detail lod, drawn as one
+		// index range; laid out to match std430 so the same array can be read by culling shaders
+		struct Meshlet {
+			glm::vec3 center = {}; // bounding sphere center in model space
+			float radius = 0.f; // bounding sphere radius in model space
+			glm::vec3 coneAxis = {}; // average facing direction of the triangles
+			float coneCutoff = 1.f; // sine of the normal cone's half angle, 1 means the cone can't be used for culling
+			uint32_t firstIndex = 0;
+			uint32_t indexCount = 0;
+			uint32_t padding[2] = {};
+		};
+
 		// struct for holding vertex and index information until it can be copied into the model's buffer memory
 		struct Builder {
 			std::vector<Vertex> vertices = {};
-			std::vector<uint32_t> indices = {};
-			void loadModel(const std::string& filepath);
+			std::vector<uint32_t> indices = {}; // every lod's indices back to back, full detail first
+			std::vector<Lod> lods = {}; // from full detail to coarsest, empty means a single lod covering all the indices
+			std::vector<Meshlet> meshlets = {}; // clusters covering the full detail lod, empty for meshes too small to split
+			glm::vec3 boundsMin = {}; // minimum corner of the mesh's axis-aligned bounding box
+			glm::vec3 boundsMax = {}; // maximum corner of the mesh's axis-aligned bounding box
+			void loadModel(const std::string& filepath); // load from the binary mesh cache, or parse the source model and write the cache
+			void computeBounds(); // compute the bounding box from the vertex positions
+			void generateLods(); // append progressively simplified copies of the full detail indices
+			void buildMeshlets(); // split the full detail lod into meshlets, reordering its triangles so each meshlet is contiguous; MeshOptimizer::optimize calls it between its passes
+			VertexFormat vertexFormat = VertexFormat::Float; // the layout the model uploads its vertices in
 		};
 
-		Model(Device& device, const Model::Builder& builder); // constructor
-		~Model(); // destructor
+		Model(Device& device, const Model::Builder& builder); // constructor, records the uploads into the device's open upload batch
+		~Model(); // destructor, waits for the upload if it's still in flight and returns the geometry to the arena
 
 		// not copyable or movable
 		Model(const Model&) = delete;
 		Model& operator = (const Model&) = delete;
 
-		static std::unique_ptr<Model> createModelFromFile(Device& device, const std::string& filepath);
+		static std::unique_ptr<Model> createModelFromFile(Device& device, const std::string& filepath, VertexFormat vertexFormat = VertexFormat::Float);
+
+		void bind(VkCommandBuffer commandBuffer); // bind the shared arena buffers holding this model, which other models in the same pools reuse
+		void draw(VkCommandBuffer commandBuffer, uint32_t lod = 0, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+
+		void drawRange(VkCommandBuffer commandBuffer, uint32_t firstIndex, uint32_t indexCount, uint32_t instanceCount = 1, uint32_t firstInstance = 0); // draw part of the model's indices, counted from its own first index, for example a run of meshlets
 
-		void bind(VkCommandBuffer commandBuffer);
-		void draw(VkCommandBuffer commandBuffer);
+		const std::vector<Lod>& getLods() const { return lods; }
+		const std::vector<Meshlet>& getMeshlets() const { return meshlets; }
+		VkBuffer getVertexBuffer() const { return vertexAllocation.isValid() ? device.getGeometryArena().getBuffer(vertexAllocation.pool) : VK_NULL_HANDLE; } // shared arena buffer, draws offset into it by getVertexOffset
+		VkBuffer getIndexBuffer() const { return indexAllocation.isValid() ? device.getGeometryArena().getBuffer(indexAllocation.pool) : VK_NULL_HANDLE; } // shared arena buffer, draws offset into it by getFirstIndex
+		uint32_t getVertexOffset() const { return vertexAllocation.first; } // first vertex of the model in the arena vertex buffer
+		uint32_t getFirstIndex() const { return indexAllocation.first; } // first index of the model in the arena index buffer
+		VkIndexType getIndexType() const { return indexType; }
+		VkBuffer getMeshletBuffer() const { return meshletBuffer ? meshletBuffer->getBuffer() : VK_NULL_HANDLE; } // storage buffer of Meshlet, for compute culling
+		const glm::vec3& getBoundsCenter() const { return boundsCenter; } // center of the bounding sphere in model space
+		float getBoundsRadius() const { return boundsRadius; } // radius of the bounding sphere in model space
+		const glm::vec3& getBoundsMin() const { return boundsMin; } // minimum corner of the axis-aligned bounding box in model space
+		const glm::vec3& getBoundsMax() const { return boundsMax; } // maximum corner of the axis-aligned bounding box in model space
+		VertexFormat getVertexFormat() const { return vertexFormat; }
+		const glm::mat4& getPositionDequantization() const { return positionDequantization; } // maps packed positions back to model space, identity for float vertices
+		UploadBatcher::BatchId getUploadBatch() const { return uploadBatch; } // the batch carrying this model's buffers
+		bool isResident() { return !evicted && device.getUploadBatcher().isComplete(uploadBatch); } // true once the upload batch has finished on the gpu
+
+		void evict(); // free the gpu copy, keeping the host copy; the caller makes sure no frame in flight still draws the model
+		void restream(); // upload the host copy again after evict, the model is resident again once the new batch finishes
+		bool isEvicted() const { return evicted; }
+		VkDeviceSize getDeviceBytes() const; // geometry bytes the model takes in device memory while it's resident
 
 	private:
-		void createVertexBuffers(const std::vector<Vertex>& vertices); // to create the vertex buffers
-		void createIndexBuffer(const std::vector<uint32_t>& indices); // to create the index buffers
+		void setVertices(const void* vertexData, uint32_t size, uint32_t count); // to keep the host copy of the vertices
+		void setIndices(const std::vector<uint32_t>& indices); // to keep the host copy of the indices, 16-bit when every vertex is addressable
+		void upload(); // to create every gpu resource from the host copies
+		void release(); // to wait for the upload and free every gpu resource
+		void createVertexBuffers(); // to create the vertex buffers
+		void createIndexBuffer(); // to create the index buffers
+		void createMeshletBuffer(); // to create the storage buffer holding the meshlets
 		Device& device; // reference to the device
 
-		std::unique_ptr<Buffer> vertexBuffer; // a handle for the vertex buffer
+		GeometryArena::Allocation vertexAllocation = {}; // a handle for the vertices in the geometry arena
 		uint32_t vertexCount; // a handle for the count of vertices
+		uint32_t vertexSize; // a handle for the bytes per vertex
+		std::vector<char> hostVertices = {}; // a handle for the host copy of the vertex bytes
+		VertexFormat vertexFormat = VertexFormat::Float; // a handle for the layout of the vertex buffer
+		glm::mat4 positionDequantization{ 1.f }; // a handle for the packed position scale and offset
 		bool hasIndexBuffer = false; // a flag for using index buffers
-		std::unique_ptr<Buffer> indexBuffer; // a handle for the index buffer
+		GeometryArena::Allocation indexAllocation = {}; // a handle for the indices in the geometry arena
 		uint32_t indexCount; // a handle for the count of indices
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32; // a handle for the width of the stored indices
+		std::vector<char> hostIndices = {}; // a handle for the host copy of the index bytes
+		std::vector<Lod> lods = {}; // a handle for the index ranges of each level of detail
+		std::vector<Meshlet> meshlets = {}; // a handle for the cpu copy of the meshlets, for cpu culling
+		std::unique_ptr<Buffer> meshletBuffer; // a handle for the meshlet storage buffer
+		glm::vec3 boundsMin = {}; // a handle for the bounding box minimum
+		glm::vec3 boundsMax = {}; // a handle for the bounding box maximum
+		glm::vec3 boundsCenter = {}; // a handle for the bounding sphere center
+		float boundsRadius = 0.f; // a handle for the bounding sphere radius
+		UploadBatcher::BatchId uploadBatch = 0; // a handle for the upload batch of the buffers
+		bool evicted = false; // a flag for only the host copy being present
+	};
+}
+
+namespace std {
+	template <>
+	struct hash<ToyBox::Model::Vertex> {
+		size_t operator()(ToyBox::Model::Vertex const& vertex) const {
+			size_t seed = 0;
+			ToyBox::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
+			return seed;
+		}
 	};
 }
\ No newline at end of file
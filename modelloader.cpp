@@ -0,0 +1,149 @@
+#include "modelloader.hpp"
+#include <iostream>
+
+namespace ToyBox {
+	ModelLoader::ModelLoader(Device& device, unsigned int threadCount) : device{ device }, threadPool{ threadCount } {}
+
+	ModelLoader::~ModelLoader() {}
+
+	std::shared_future<std::shared_ptr<Model>> ModelLoader::load(const std::string& filepath, Model::VertexFormat vertexFormat, Callback onResident) {
+		auto request = std::make_shared<Request>();
+		request->filepath = filepath;
+		request->vertexFormat = vertexFormat;
+		request->onResident = std::move(onResident);
+		request->requestTime = Clock::now();
+		std::shared_future<std::shared_ptr<Model>> result = request->promise.get_future().share();
+
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			pendingCount++;
+		}
+
+		// the worker fills in the request and hands it back through parsed, so only one thread touches it at a time
+		threadPool.submit([this, request]() {
+			auto start = Clock::now();
+			try {
+				request->builder.loadModel(request->filepath);
+				request->builder.vertexFormat = request->vertexFormat;
+			}
+			catch (...) {
+				request->error = std::current_exception();
+			}
+			request->parseMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				parsed.push_back(request);
+			}
+			parsedCondition.notify_all();
+		});
+
+		return result;
+	}
+
+	void ModelLoader::update() {
+		std::vector<std::shared_ptr<Request>> ready = {};
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+
+			// take requests in completion order until the budget is spent, always at least one so large models still make progress
+			VkDeviceSize bytes = 0;
+			size_t count = 0;
+			while (count < parsed.size() && (count == 0 || bytes < uploadBudget)) {
+				const auto& builder = parsed[count]->builder;
+				bytes += builder.vertices.size() * sizeof(Model::Vertex) + builder.indices.size() * sizeof(uint32_t);
+				count++;
+			}
+			ready.assign(parsed.begin(), parsed.begin() + count);
+			parsed.erase(parsed.begin(), parsed.begin() + count);
+		}
+
+		// every model created here records its copies into the same upload batch, which is submitted once below
+		UploadBatcher& uploadBatcher = device.getUploadBatcher();
+		for (auto& request : ready) {
+			if (!request->error) {
+				try {
+					try {
+						request->model = std::make_shared<Model>(device, request->builder);
+					}
+					catch (const OutOfDeviceMemoryError&) {
+						// evict idle models and try once more before giving up on this one, other failures give up right away
+						const auto& builder = request->builder;
+						VkDeviceSize bytes = builder.vertices.size() * sizeof(Model::Vertex) + builder.indices.size() * sizeof(uint32_t);
+						if (residencyManager == nullptr || !residencyManager->makeRoom(bytes)) throw;
+						request->model = std::make_shared<Model>(device, request->builder);
+					}
+					request->builder = {}; // the model keeps its own host copy
+					if (residencyManager) residencyManager->track(request->model);
+				}
+				catch (...) {
+					request->error = std::current_exception();
+				}
+			}
+
+			if (request->error) {
+				finish(*request);
+			}
+			else {
+				uploading.push_back(request);
+			}
+		}
+		if (!ready.empty()) uploadBatcher.flush();
+
+		// a model only becomes visible once the batch carrying its buffers has finished
+		for (auto it = uploading.begin(); it != uploading.end();) {
+			if (uploadBatcher.isComplete((*it)->model->getUploadBatch())) {
+				finish(**it);
+				it = uploading.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+	}
+
+	void ModelLoader::waitIdle() {
+		while (getPendingCount() > 0) {
+			if (!uploading.empty()) {
+				device.getUploadBatcher().wait(uploading.front()->model->getUploadBatch());
+			}
+			else {
+				std::unique_lock<std::mutex> lock{ mutex };
+				parsedCondition.wait(lock, [this]() { return !parsed.empty() || pendingCount == 0; });
+			}
+			update();
+		}
+	}
+
+	void ModelLoader::finish(Request& request) {
+		if (request.error) {
+			try {
+				std::rethrow_exception(request.error);
+			}
+			catch (const std::exception& e) {
+				std::cerr << "failed to load model " << request.filepath << ": " << e.what() << std::endl;
+			}
+			request.promise.set_exception(request.error);
+		}
+		else {
+			double latency = std::chrono::duration<double, std::milli>(Clock::now() - request.requestTime).count();
+			std::cout << "model resident: " << request.filepath << " (parse " << request.parseMilliseconds << " ms, " << latency << " ms after request)" << std::endl;
+			request.promise.set_value(request.model);
+			// a failing callback must not leave the request pending, the model itself loaded fine
+			try {
+				if (request.onResident) request.onResident(request.model);
+			}
+			catch (const std::exception& e) {
+				std::cerr << "failed to use model " << request.filepath << ": " << e.what() << std::endl;
+			}
+		}
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		pendingCount--;
+	}
+
+	size_t ModelLoader::getPendingCount() {
+		std::lock_guard<std::mutex> lock{ mutex };
+		return pendingCount;
+	}
+}
\ No newline at end of file
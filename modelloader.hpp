@@ -0,0 +1,66 @@
+#pragma once
+#include "model.hpp"
+#include "residencymanager.hpp"
+#include "threadpool.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ToyBox {
+	// loads models in the background: parsing (or reading the mesh cache) runs on worker threads,
+	// while the uploads are recorded on the main thread in update() so no Vulkan object is touched from two threads
+	class ModelLoader {
+	public:
+		using Callback = std::function<void(std::shared_ptr<Model>)>;
+		using Clock = std::chrono::high_resolution_clock;
+
+		ModelLoader(Device& device, unsigned int threadCount = 0); // constructor
+		~ModelLoader(); // destructor
+
+		// not copyable or movable
+		ModelLoader(const ModelLoader&) = delete;
+		ModelLoader& operator = (const ModelLoader&) = delete;
+
+		// start loading and return immediately; the future becomes ready and onResident runs (on the main thread, inside update())
+		// once the upload batch carrying the model has finished on the gpu, and the future rethrows if the file couldn't be loaded
+		std::shared_future<std::shared_ptr<Model>> load(const std::string& filepath, Model::VertexFormat vertexFormat = Model::VertexFormat::Float, Callback onResident = nullptr);
+
+		void update(); // upload parsed models in one batch, at least one and then until the upload budget is spent, and hand out finished ones; call once per frame
+		void waitIdle(); // block until every requested model is resident (or failed)
+
+		size_t getPendingCount(); // models requested but not resident yet
+		void setUploadBudget(VkDeviceSize bytes) { uploadBudget = bytes; } // vertex and index bytes uploaded per update() call
+		void setResidencyManager(ResidencyManager* manager) { residencyManager = manager; } // track loaded models, and evict others when an upload runs out of memory
+
+	private:
+		// everything about one load, handed from the worker back to the main thread
+		struct Request {
+			std::string filepath;
+			Model::VertexFormat vertexFormat;
+			Callback onResident;
+			std::promise<std::shared_ptr<Model>> promise;
+			Clock::time_point requestTime;
+			double parseMilliseconds = 0.0;
+			Model::Builder builder = {};
+			std::shared_ptr<Model> model = nullptr;
+			std::exception_ptr error = nullptr;
+		};
+
+		void finish(Request& request); // fulfil the future and run the callback, or report the error
+
+		Device& device; // a handle for the device instance
+		VkDeviceSize uploadBudget = 64 * 1024 * 1024; // a handle for the per-update upload budget
+		ResidencyManager* residencyManager = nullptr; // a handle for the residency manager, if any
+		std::mutex mutex; // guards parsed and pendingCount
+		std::condition_variable parsedCondition; // signalled when a worker finishes a request
+		std::vector<std::shared_ptr<Request>> parsed = {}; // a handle for the requests waiting for upload
+		std::vector<std::shared_ptr<Request>> uploading = {}; // a handle for the requests whose upload batch is still in flight, main thread only
+		size_t pendingCount = 0; // a handle for the number of unfinished requests
+		ThreadPool threadPool; // declared last so the workers stop before the members they write to are destroyed
+	};
+}
\ No newline at end of file
@@ -0,0 +1,362 @@
+#include "objloader.hpp"
+#include "mappedfile.hpp"
+#include "vertextable.hpp"
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace ToyBox {
+	namespace {
+		// flags describing which attributes a face corner references and which of them are relative (negative) indices
+		enum CornerFlags : uint8_t {
+			HAS_TEXCOORD = 1 << 0,
+			HAS_NORMAL = 1 << 1,
+			RELATIVE_POSITION = 1 << 2,
+			RELATIVE_TEXCOORD = 1 << 3,
+			RELATIVE_NORMAL = 1 << 4,
+		};
+
+		// one corner of a triangle; relative indices are stored against the start of their chunk until resolved
+		struct ObjCorner {
+			int32_t position;
+			int32_t texcoord;
+			int32_t normal;
+			uint8_t flags;
+		};
+
+		// everything parsed out of one line-aligned slice of the file
+		struct ObjChunk {
+			std::vector<float> positions = {}; // 3 floats per vertex
+			std::vector<float> colors = {}; // 3 floats per vertex, white when the file has no vertex colors
+			std::vector<float> normals = {}; // 3 floats per normal
+			std::vector<float> texcoords = {}; // 2 floats per texture coordinate
+			std::vector<ObjCorner> corners = {}; // 3 corners per triangle
+		};
+
+		bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+		const char* skipSpace(const char* p, const char* end) {
+			while (p < end && isSpace(*p)) p++;
+			return p;
+		}
+
+		// parse up to maxCount floats, returns how many were read
+		int parseFloats(const char* p, const char* end, float* out, int maxCount) {
+			int count = 0;
+			while (count < maxCount) {
+				p = skipSpace(p, end);
+				if (p < end && *p == '+') p++; // from_chars does not accept a leading plus sign
+				auto result = std::from_chars(p, end, out[count]);
+				if (result.ec != std::errc()) break;
+				p = result.ptr;
+				count++;
+			}
+			return count;
+		}
+
+		// parse one v, v/vt, v//vn or v/vt/vn token
+		const char* parseCorner(const char* p, const char* end, const ObjChunk& chunk, ObjCorner& corner, const std::string& filepath) {
+			auto resolve = [&](int32_t value, size_t localCount, uint8_t relativeFlag, int32_t& out) {
+				if (value > 0) {
+					out = value - 1;
+				}
+				else if (value < 0) {
+					out = static_cast<int32_t>(localCount) + value;
+					corner.flags |= relativeFlag;
+				}
+				else {
+					throw std::runtime_error("invalid face index in " + filepath);
+				}
+			};
+
+			corner = {};
+			int32_t value = 0;
+			auto result = std::from_chars(p, end, value);
+			if (result.ec != std::errc()) {
+				throw std::runtime_error("invalid face in " + filepath);
+			}
+			resolve(value, chunk.positions.size() / 3, RELATIVE_POSITION, corner.position);
+			p = result.ptr;
+
+			if (p < end && *p == '/') {
+				p++;
+				if (p < end && *p != '/') {
+					result = std::from_chars(p, end, value);
+					if (result.ec == std::errc()) {
+						resolve(value, chunk.texcoords.size() / 2, RELATIVE_TEXCOORD, corner.texcoord);
+						corner.flags |= HAS_TEXCOORD;
+						p = result.ptr;
+					}
+				}
+				if (p < end && *p == '/') {
+					p++;
+					result = std::from_chars(p, end, value);
+					if (result.ec == std::errc()) {
+						resolve(value, chunk.normals.size() / 3, RELATIVE_NORMAL, corner.normal);
+						corner.flags |= HAS_NORMAL;
+						p = result.ptr;
+					}
+				}
+			}
+
+			return p;
+		}
+
+		void parseLine(const char* p, const char* end, ObjChunk& chunk, std::vector<ObjCorner>& polygon, const std::string& filepath) {
+			p = skipSpace(p, end);
+			if (end - p < 2) return;
+
+			if (p[0] == 'v' && isSpace(p[1])) {
+				// position, optionally followed by an rgb vertex color
+				float values[6] = { 0.f, 0.f, 0.f, 1.f, 1.f, 1.f };
+				int count = parseFloats(p + 2, end, values, 6);
+				if (count < 3) {
+					throw std::runtime_error("invalid vertex in " + filepath);
+				}
+				chunk.positions.insert(chunk.positions.end(), values, values + 3);
+				if (count < 6) {
+					values[3] = values[4] = values[5] = 1.f;
+				}
+				chunk.colors.insert(chunk.colors.end(), values + 3, values + 6);
+			}
+			else if (p[0] == 'v' && p[1] == 'n' && end - p > 2 && isSpace(p[2])) {
+				float values[3] = {};
+				parseFloats(p + 3, end, values, 3);
+				chunk.normals.insert(chunk.normals.end(), values, values + 3);
+			}
+			else if (p[0] == 'v' && p[1] == 't' && end - p > 2 && isSpace(p[2])) {
+				float values[2] = {};
+				parseFloats(p + 3, end, values, 2);
+				chunk.texcoords.insert(chunk.texcoords.end(), values, values + 2);
+			}
+			else if (p[0] == 'f' && isSpace(p[1])) {
+				polygon.clear();
+				p = skipSpace(p + 2, end);
+				while (p < end && *p != '#') { // a comment may follow the last corner
+					ObjCorner corner;
+					p = skipSpace(parseCorner(p, end, chunk, corner, filepath), end);
+					polygon.push_back(corner);
+				}
+
+				// triangulate polygons as a fan around the first corner
+				for (size_t i = 2; i < polygon.size(); i++) {
+					chunk.corners.push_back(polygon[0]);
+					chunk.corners.push_back(polygon[i - 1]);
+					chunk.corners.push_back(polygon[i]);
+				}
+			}
+			// comments, groups, smoothing groups and materials are ignored
+		}
+
+		void parseChunk(const char* begin, const char* end, ObjChunk& chunk, const std::string& filepath) {
+			// guess capacities from the chunk size so most chunks never reallocate
+			const size_t estimatedLines = static_cast<size_t>(end - begin) / 24;
+			chunk.positions.reserve(estimatedLines);
+			chunk.colors.reserve(estimatedLines);
+			chunk.corners.reserve(estimatedLines * 2);
+
+			std::vector<ObjCorner> polygon = {};
+			const char* p = begin;
+			while (p < end) {
+				const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+				if (lineEnd == nullptr) lineEnd = end;
+				parseLine(p, lineEnd, chunk, polygon, filepath);
+				p = lineEnd + 1;
+			}
+		}
+	}
+
+	void ObjLoader::load(const std::string& filepath, Model::Builder& builder, unsigned int threadCount) {
+		MappedFile file{ filepath };
+		const char* data = reinterpret_cast<const char*>(file.data());
+		const size_t size = file.size();
+
+		// split into line-aligned chunks, but don't bother spinning up threads for small files
+		if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+		constexpr size_t minChunkSize = 1 << 20;
+		const size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount, size / minChunkSize));
+
+		std::vector<const char*> bounds(chunkCount + 1);
+		bounds[0] = data;
+		bounds[chunkCount] = data + size;
+		for (size_t i = 1; i < chunkCount; i++) {
+			const char* p = std::max(data + size * i / chunkCount, bounds[i - 1]);
+			const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', data + size - p));
+			bounds[i] = lineEnd ? lineEnd + 1 : data + size;
+		}
+
+		// parse every chunk in parallel, exceptions are rethrown by get()
+		std::vector<ObjChunk> chunks(chunkCount);
+		std::vector<std::future<void>> tasks = {};
+		for (size_t i = 1; i < chunkCount; i++) {
+			tasks.push_back(std::async(std::launch::async, parseChunk, bounds[i], bounds[i + 1], std::ref(chunks[i]), std::cref(filepath)));
+		}
+		parseChunk(bounds[0], bounds[1], chunks[0], filepath);
+		for (auto& task : tasks) task.get();
+
+		// gather the attributes into single arrays, releasing each chunk's copy as we go;
+		// the running totals become the base for each chunk's relative indices
+		std::vector<size_t> positionBase(chunkCount), normalBase(chunkCount), texcoordBase(chunkCount);
+		size_t positionCount = 0, normalCount = 0, texcoordCount = 0;
+		for (size_t i = 0; i < chunkCount; i++) {
+			positionBase[i] = positionCount;
+			normalBase[i] = normalCount;
+			texcoordBase[i] = texcoordCount;
+			positionCount += chunks[i].positions.size() / 3;
+			normalCount += chunks[i].normals.size() / 3;
+			texcoordCount += chunks[i].texcoords.size() / 2;
+		}
+
+		std::vector<float> positions = {}, colors = {}, normals = {}, texcoords = {};
+		positions.reserve(positionCount * 3);
+		colors.reserve(positionCount * 3);
+		normals.reserve(normalCount * 3);
+		texcoords.reserve(texcoordCount * 2);
+		for (auto& chunk : chunks) {
+			positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+			colors.insert(colors.end(), chunk.colors.begin(), chunk.colors.end());
+			normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+			texcoords.insert(texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+			chunk.positions = {};
+			chunk.colors = {};
+			chunk.normals = {};
+			chunk.texcoords = {};
+		}
+
+		auto checkIndex = [&](int64_t index, size_t count) {
+			if (index < 0 || static_cast<size_t>(index) >= count) {
+				throw std::runtime_error("face index out of range in " + filepath);
+			}
+			return static_cast<size_t>(index);
+		};
+
+		// build and deduplicate each chunk's vertices on its own thread, then merge the chunks in file order
+		std::vector<std::vector<Model::Vertex>> chunkVertices(chunkCount);
+		std::vector<std::vector<uint32_t>> chunkIndices(chunkCount);
+		auto buildChunk = [&](size_t c) {
+			auto& corners = chunks[c].corners;
+			auto& indices = chunkIndices[c];
+			indices.reserve(corners.size());
+			VertexTable uniqueVertices{ chunkVertices[c], corners.size() / 4 };
+
+			for (const auto& corner : corners) {
+				Model::Vertex vertex = {};
+
+				size_t position = checkIndex(corner.position + static_cast<int64_t>((corner.flags & RELATIVE_POSITION) ? positionBase[c] : 0), positionCount);
+				vertex.position = { positions[3 * position + 0], positions[3 * position + 1], positions[3 * position + 2] };
+				vertex.color = { colors[3 * position + 0], colors[3 * position + 1], colors[3 * position + 2] };
+
+				if (corner.flags & HAS_NORMAL) {
+					size_t normal = checkIndex(corner.normal + static_cast<int64_t>((corner.flags & RELATIVE_NORMAL) ? normalBase[c] : 0), normalCount);
+					vertex.normal = { normals[3 * normal + 0], normals[3 * normal + 1], normals[3 * normal + 2] };
+				}
+
+				if (corner.flags & HAS_TEXCOORD) {
+					size_t texcoord = checkIndex(corner.texcoord + static_cast<int64_t>((corner.flags & RELATIVE_TEXCOORD) ? texcoordBase[c] : 0), texcoordCount);
+					vertex.uv = { texcoords[2 * texcoord + 0], texcoords[2 * texcoord + 1] };
+				}
+
+				indices.push_back(uniqueVertices.findOrInsert(vertex));
+			}
+			corners = {};
+		};
+
+		tasks.clear();
+		for (size_t c = 1; c < chunkCount; c++) {
+			tasks.push_back(std::async(std::launch::async, buildChunk, c));
+		}
+		buildChunk(0);
+		for (auto& task : tasks) task.get();
+
+		VertexTable::merge(chunkVertices, chunkIndices, builder.vertices, builder.indices);
+	}
+
+	void ObjLoader::loadWithTinyObj(const std::string& filepath, Model::Builder& builder) {
+		tinyobj::attrib_t attrib;
+		std::vector<tinyobj::shape_t> shapes;
+		std::vector<tinyobj::material_t> materials;
+		std::string warn, err;
+
+		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepath.c_str())) {
+			throw std::runtime_error(warn + err);
+		}
+
+		// start from a fresh builder state
+		builder.vertices.clear();
+		builder.indices.clear();
+
+		std::unordered_map<Model::Vertex, uint32_t> uniqueVertices = {};
+
+		for (const auto& shape : shapes) {
+			for (const auto& index : shape.mesh.indices) {
+				Model::Vertex vertex = {};
+
+				if (index.vertex_index >= 0) {
+					vertex.position = {
+						attrib.vertices[3 * index.vertex_index + 0],
+						attrib.vertices[3 * index.vertex_index + 1],
+						attrib.vertices[3 * index.vertex_index + 2],
+					};
+
+					vertex.color = {
+						attrib.colors[3 * index.vertex_index + 0],
+						attrib.colors[3 * index.vertex_index + 1],
+						attrib.colors[3 * index.vertex_index + 2],
+					};
+				}
+
+				if (index.normal_index >= 0) {
+					vertex.normal = {
+						attrib.normals[3 * index.normal_index + 0],
+						attrib.normals[3 * index.normal_index + 1],
+						attrib.normals[3 * index.normal_index + 2],
+					};
+				}
+
+				if (index.texcoord_index >= 0) {
+					vertex.uv = {
+						attrib.texcoords[2 * index.texcoord_index + 0],
+						attrib.texcoords[2 * index.texcoord_index + 1],
+					};
+				}
+
+				if (uniqueVertices.count(vertex) == 0) {
+					uniqueVertices[vertex] = static_cast<uint32_t>(builder.vertices.size());
+					builder.vertices.push_back(vertex);
+				}
+				builder.indices.push_back(uniqueVertices[vertex]);
+			}
+		}
+	}
+
+	void ObjLoader::benchmark(const std::string& filepath, int iterations) {
+		const double megabytes = static_cast<double>(MappedFile{ filepath }.size()) / (1024.0 * 1024.0);
+
+		auto measure = [&](const char* name, auto&& loadFunction) {
+			double bestSeconds = 0.0;
+			Model::Builder builder = {};
+			for (int i = 0; i < iterations; i++) {
+				auto start = std::chrono::high_resolution_clock::now();
+				loadFunction(builder);
+				double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+				if (i == 0 || seconds < bestSeconds) bestSeconds = seconds;
+			}
+			std::cout << "\t" << name << ": " << bestSeconds * 1000.0 << " ms, " << megabytes / bestSeconds << " MB/s ("
+				<< builder.vertices.size() << " vertices, " << builder.indices.size() << " indices)" << std::endl;
+		};
+
+		std::cout << "obj benchmark: " << filepath << " (" << megabytes << " MB, best of " << iterations << ")" << std::endl;
+		measure("tinyobj", [&](Model::Builder& builder) { loadWithTinyObj(filepath, builder); });
+		measure("streaming, 1 thread", [&](Model::Builder& builder) { load(filepath, builder, 1); });
+		measure("streaming, all threads", [&](Model::Builder& builder) { load(filepath, builder); });
+	}
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+#include "model.hpp"
+#include <string>
+
+namespace ToyBox {
+	// wavefront .obj reader that splits the file into line-aligned chunks, parses them in parallel
+	// and streams the faces straight into a Model::Builder
+	class ObjLoader {
+	public:
+		// parse the file into the builder's vertices and indices (0 threads means one per hardware thread)
+		static void load(const std::string& filepath, Model::Builder& builder, unsigned int threadCount = 0);
+
+		// time this loader against the tinyobj path on the same file and print the throughput in MB/s
+		static void benchmark(const std::string& filepath, int iterations = 5);
+
+	private:
+		static void loadWithTinyObj(const std::string& filepath, Model::Builder& builder); // the reference path used by the benchmark
+	};
+}
\ No newline at end of file
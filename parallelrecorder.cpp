@@ -0,0 +1,144 @@
+#include "parallelrecorder.hpp"
+#include <algorithm>
+#include <future>
+#include <stdexcept>
+
+namespace ToyBox {
+	ParallelRecorder::ParallelRecorder(Device& device, unsigned int threadCount) : device{ device }, threadPool{ threadCount } {
+		// command pools are externally synchronized, so every worker gets its own for each frame in flight
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = device.findPhysicalQueueFamilies().graphicsFamily;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		for (auto& framePools : workerPools) {
+			framePools.resize(threadPool.getThreadCount());
+			for (auto& workerPool : framePools) {
+				if (vkCreateCommandPool(device.getDevice(), &poolInfo, nullptr, &workerPool.pool) != VK_SUCCESS) {
+					throw std::runtime_error("failed to create secondary command pool!");
+				}
+			}
+		}
+	}
+
+	ParallelRecorder::~ParallelRecorder() {
+		for (auto& framePools : workerPools) {
+			for (auto& workerPool : framePools) {
+				vkDestroyCommandPool(device.getDevice(), workerPool.pool, nullptr); // frees its command buffers too
+			}
+		}
+	}
+
+	void ParallelRecorder::beginFrame(int frameIndex) {
+		this->frameIndex = frameIndex;
+		secondaryCount = 0;
+		for (auto& workerPool : workerPools[frameIndex]) {
+			vkResetCommandPool(device.getDevice(), workerPool.pool, 0);
+			workerPool.used = 0;
+		}
+	}
+
+	void ParallelRecorder::beginRenderPass(VkRenderPass renderPass, VkFramebuffer framebuffer, VkExtent2D extent) {
+		this->renderPass = renderPass;
+		this->framebuffer = framebuffer;
+		this->extent = extent;
+	}
+
+	size_t ParallelRecorder::getTaskCount(size_t count, size_t minItemsPerTask) const {
+		size_t taskCount = (count + std::max<size_t>(minItemsPerTask, 1) - 1) / std::max<size_t>(minItemsPerTask, 1);
+		return std::min<size_t>(taskCount, threadPool.getThreadCount());
+	}
+
+	VkCommandBuffer ParallelRecorder::acquireCommandBuffer(WorkerPool& workerPool) {
+		if (workerPool.used == workerPool.commandBuffers.size()) {
+			VkCommandBufferAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocInfo.commandPool = workerPool.pool;
+			allocInfo.commandBufferCount = 1;
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+			if (vkAllocateCommandBuffers(device.getDevice(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+				throw std::runtime_error("failed to allocate secondary command buffer!");
+			}
+			workerPool.commandBuffers.push_back(commandBuffer);
+		}
+		return workerPool.commandBuffers[workerPool.used++];
+	}
+
+	void ParallelRecorder::record(VkCommandBuffer primaryCommandBuffer, size_t count, size_t minItemsPerTask, const RecordRange& recordRange) {
+		if (count == 0) return;
+		const size_t taskCount = getTaskCount(count, minItemsPerTask);
+
+		// the buffers are picked on this thread, each task only touches its own worker's pool
+		recorded.resize(taskCount);
+		for (size_t task = 0; task < taskCount; task++) {
+			recorded[task] = acquireCommandBuffer(workerPools[frameIndex][task]);
+		}
+
+		std::vector<std::future<void>> tasks = {};
+		tasks.reserve(taskCount);
+		for (size_t task = 0; task < taskCount; task++) {
+			const size_t begin = count * task / taskCount;
+			const size_t end = count * (task + 1) / taskCount;
+			VkCommandBuffer commandBuffer = recorded[task];
+			tasks.push_back(threadPool.submit([this, &recordRange, commandBuffer, begin, end, task]() {
+				// the secondary buffer continues the render pass, and dynamic state isn't inherited from the primary
+				VkCommandBufferInheritanceInfo inheritanceInfo = {};
+				inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+				inheritanceInfo.renderPass = renderPass;
+				inheritanceInfo.subpass = 0;
+				inheritanceInfo.framebuffer = framebuffer;
+
+				VkCommandBufferBeginInfo beginInfo = {};
+				beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+				beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+				beginInfo.pInheritanceInfo = &inheritanceInfo;
+				if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+					throw std::runtime_error("failed to begin recording secondary command buffer!");
+				}
+
+				VkViewport viewport{ 0.f, 0.f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.f, 1.f };
+				VkRect2D scissor{ { 0, 0 }, extent };
+				vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+				vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+				recordRange(commandBuffer, begin, end, static_cast<unsigned int>(task));
+
+				if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+					throw std::runtime_error("failed to record secondary command buffer!");
+				}
+			}));
+		}
+
+		// wait for every task before rethrowing, so none is still recording when the caller moves on
+		for (auto& task : tasks) task.wait();
+		for (auto& task : tasks) task.get();
+
+		vkCmdExecuteCommands(primaryCommandBuffer, static_cast<uint32_t>(recorded.size()), recorded.data());
+		secondaryCount += static_cast<uint32_t>(recorded.size());
+	}
+
+	void ParallelRecorder::forEachRange(size_t count, size_t minItemsPerTask, const ProcessRange& processRange) {
+		if (count == 0) return;
+		const size_t taskCount = getTaskCount(count, minItemsPerTask);
+
+		// the calling thread takes the first range instead of waiting idle
+		std::vector<std::future<void>> tasks = {};
+		tasks.reserve(taskCount - 1);
+		for (size_t task = 1; task < taskCount; task++) {
+			const size_t begin = count * task / taskCount;
+			const size_t end = count * (task + 1) / taskCount;
+			tasks.push_back(threadPool.submit([&processRange, begin, end, task]() { processRange(begin, end, static_cast<unsigned int>(task)); }));
+		}
+		std::exception_ptr error = nullptr;
+		try {
+			processRange(0, count / taskCount, 0);
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+
+		for (auto& task : tasks) task.wait();
+		if (error) std::rethrow_exception(error);
+		for (auto& task : tasks) task.get();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+#include "device.hpp"
+#include "swapchain.hpp"
+#include "threadpool.hpp"
+#include <array>
+#include <functional>
+#include <vector>
+
+namespace ToyBox {
+	// records the draws inside the swap chain render pass on worker threads: a range of items is split into one task per
+	// worker, each task records a secondary command buffer from a command pool only it uses, and the primary executes them
+	// in range order. every worker has a pool per frame in flight, reset wholesale once that frame's fence has signalled.
+	// record and forEachRange are called from the main thread and return once every task has finished
+	class ParallelRecorder {
+	public:
+		using RecordRange = std::function<void(VkCommandBuffer commandBuffer, size_t begin, size_t end, unsigned int worker)>;
+		using ProcessRange = std::function<void(size_t begin, size_t end, unsigned int worker)>;
+
+		ParallelRecorder(Device& device, unsigned int threadCount = 0); // constructor, 0 threads means one per hardware thread
+		~ParallelRecorder(); // destructor
+
+		// not copyable or movable
+		ParallelRecorder(const ParallelRecorder&) = delete;
+		ParallelRecorder& operator = (const ParallelRecorder&) = delete;
+
+		void beginFrame(int frameIndex); // reset the frame's pools, after its fence has signalled
+		void beginRenderPass(VkRenderPass renderPass, VkFramebuffer framebuffer, VkExtent2D extent); // what the secondary buffers continue
+
+		// split count items into ranges of at least minItemsPerTask, record each range into a secondary buffer with the viewport and
+		// scissor already set, then execute them all in primaryCommandBuffer; nothing is recorded for an empty range
+		void record(VkCommandBuffer primaryCommandBuffer, size_t count, size_t minItemsPerTask, const RecordRange& recordRange);
+		void forEachRange(size_t count, size_t minItemsPerTask, const ProcessRange& processRange); // the same split for work that records nothing
+
+		unsigned int getThreadCount() const { return threadPool.getThreadCount(); }
+		uint32_t getSecondaryCount() const { return secondaryCount; } // secondary buffers recorded this frame
+
+	private:
+		// a worker's pool for one frame in flight, with the secondary buffers allocated from it so far
+		struct WorkerPool {
+			VkCommandPool pool = VK_NULL_HANDLE;
+			std::vector<VkCommandBuffer> commandBuffers = {};
+			size_t used = 0; // buffers handed out this frame
+		};
+
+		size_t getTaskCount(size_t count, size_t minItemsPerTask) const; // how many ranges to split count items into
+		VkCommandBuffer acquireCommandBuffer(WorkerPool& workerPool); // the next free secondary buffer of a pool, allocating one if needed
+
+		Device& device; // a handle for the device instance
+		std::array<std::vector<WorkerPool>, SwapChain::MAX_FRAMES_IN_FLIGHT> workerPools = {}; // a handle for each worker's pool, per frame in flight
+		int frameIndex = 0; // a handle for the frame in flight being recorded
+		VkRenderPass renderPass = VK_NULL_HANDLE; // a handle for the render pass being recorded
+		VkFramebuffer framebuffer = VK_NULL_HANDLE; // a handle for the framebuffer being recorded
+		VkExtent2D extent = {}; // a handle for the viewport and scissor size
+		std::vector<VkCommandBuffer> recorded = {}; // a handle for the buffers of the current record call, in range order
+		uint32_t secondaryCount = 0; // a handle for the secondary buffers recorded this frame
+		ThreadPool threadPool; // declared last so the workers stop before the pools are destroyed
+	};
+}
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "pipeline.hpp"
 #include "model.hpp"
+#include "pipelinecache.hpp"
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <cassert>
@@ -42,6 +44,14 @@ namespace ToyBox {
 		createShaderModule(vertCode, &vertShaderModule);
 		createShaderModule(fragCode, &fragShaderModule);
 
+		// specialization constants select the shader permutation, both stages read from the same data
+		VkSpecializationInfo specializationInfo = {};
+		specializationInfo.mapEntryCount = static_cast<uint32_t>(configInfo.specialization.entries.size());
+		specializationInfo.pMapEntries = configInfo.specialization.entries.data();
+		specializationInfo.dataSize = configInfo.specialization.data.size();
+		specializationInfo.pData = configInfo.specialization.data.data();
+		const VkSpecializationInfo* specialization = configInfo.specialization.empty() ? nullptr : &specializationInfo;
+
 		// fill in shader structs
 		VkPipelineShaderStageCreateInfo shaderStages[2];
 		shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -50,14 +60,14 @@ namespace ToyBox {
 		shaderStages[0].pName = "main";
 		shaderStages[0].flags = 0;
 		shaderStages[0].pNext = nullptr;
-		shaderStages[0].pSpecializationInfo = nullptr;
+		shaderStages[0].pSpecializationInfo = specialization;
 		shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT; // second index is the fragment shader
 		shaderStages[1].module = fragShaderModule;
 		shaderStages[1].pName = "main";
 		shaderStages[1].flags = 0;
 		shaderStages[1].pNext = nullptr;
-		shaderStages[1].pSpecializationInfo = nullptr;
+		shaderStages[1].pSpecializationInfo = specialization;
 
 		// define how to interpret the vertex data, which is the initial input into the graphics pipeline
 		auto& bindingDescriptions = configInfo.bindingDescriptions;
@@ -89,13 +99,17 @@ namespace ToyBox {
 		pipelineInfo.subpass = configInfo.subpass;
 
 		// optional pipeline derivative parameters; can be less expensive for a GPU to derive an existing pipeline than create a new one
+		pipelineInfo.flags = configInfo.createFlags;
 		pipelineInfo.basePipelineIndex = -1;
-		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+		pipelineInfo.basePipelineHandle = configInfo.basePipelineHandle;
 
-		// create the graphics pipeline
-		if (vkCreateGraphicsPipelines(device.getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+		// create the graphics pipeline through the shared cache, timing it to compare cold and warm starts
+		PipelineCache& pipelineCache = device.getPipelineCache();
+		auto start = std::chrono::high_resolution_clock::now();
+		if (vkCreateGraphicsPipelines(device.getDevice(), pipelineCache.getCache(), 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create graphics pipeline!");
 		}
+		pipelineCache.recordCreation(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
 	}
 
 	void Pipeline::createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule) {
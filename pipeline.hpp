@@ -1,11 +1,33 @@
 #pragma once
 #include "device.hpp"
+#include <cstring>
 #include <string>
 #include <vector>
 
 namespace ToyBox {
+	// specialization constants handed to both shader stages; constants a stage doesn't declare are ignored by it
+	struct SpecializationConstants {
+		std::vector<VkSpecializationMapEntry> entries = {};
+		std::vector<char> data = {};
+
+		// bool constants must be passed as VkBool32
+		template <typename T>
+		void set(uint32_t constantId, const T& value) {
+			VkSpecializationMapEntry entry = {};
+			entry.constantID = constantId;
+			entry.offset = static_cast<uint32_t>(data.size());
+			entry.size = sizeof(T);
+			entries.push_back(entry);
+			data.resize(data.size() + sizeof(T));
+			std::memcpy(data.data() + entry.offset, &value, sizeof(T));
+		}
+
+		bool empty() const { return entries.empty(); }
+	};
+
 	// struct to contain and share data on how we want to configure the pipeline
 	struct PipelineConfigInfo {
+		PipelineConfigInfo() = default;
 		PipelineConfigInfo(const PipelineConfigInfo&) = delete;
 		PipelineConfigInfo& operator = (const PipelineConfigInfo&) = delete;
 
@@ -23,6 +45,9 @@ namespace ToyBox {
 		VkPipelineLayout pipelineLayout = nullptr;
 		VkRenderPass renderPass = nullptr;
 		uint32_t subpass = 0;
+		SpecializationConstants specialization = {}; // the permutation of the shaders, part of the pipeline registry's key
+		VkPipelineCreateFlags createFlags = 0; // derivative flags, set by the pipeline registry
+		VkPipeline basePipelineHandle = VK_NULL_HANDLE; // the parent of a derivative pipeline
 	};
 
 	class Pipeline {
@@ -35,10 +60,11 @@ namespace ToyBox {
 		Pipeline& operator = (const Pipeline&) = delete;
 
 		void bind(VkCommandBuffer commandBuffer); // bind a pipeline
+		VkPipeline getPipeline() const { return graphicsPipeline; }
 		static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo); // to set up the pipeline's fixed functions
+		static std::vector<char> readFile(const std::string& filepath); // to read a file, also used for compute shaders
 
 	private:
-		static std::vector<char> readFile(const std::string& filepath); // to read a file
 		void createGraphicsPipeline(const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo); // to set up the graphics pipeline
 		void createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule); // for loading vertex buffer data
 
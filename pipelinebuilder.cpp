@@ -0,0 +1,70 @@
+#include "pipelinebuilder.hpp"
+
+namespace ToyBox {
+	PipelineBuilder::PipelineBuilder(Device& device, unsigned int threadCount) : device{ device }, threadPool{ threadCount } {}
+
+	PipelineBuilder::~PipelineBuilder() {}
+
+	PipelineBuilder::Handle PipelineBuilder::build(const std::string& vertFilepath, const std::string& fragFilepath, std::unique_ptr<PipelineConfigInfo> configInfo, Handle basePipeline) {
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			if (handles.empty()) firstQueued = Clock::now();
+		}
+		pendingCount++;
+
+		// the task owns the config until the pipeline has been created from it
+		std::shared_ptr<PipelineConfigInfo> config = std::move(configInfo);
+		Handle handle = threadPool.submit([this, vertFilepath, fragFilepath, config, basePipeline]() {
+			// only derived from a base that has already finished; waiting for one would hold this worker while the base compiles,
+			// and every variant of a family would queue up behind the first, so a base still compiling is built without
+			bool derived = false;
+			if (basePipeline.valid() && basePipeline.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+				try {
+					config->basePipelineHandle = basePipeline.get()->getPipeline();
+					config->createFlags |= VK_PIPELINE_CREATE_DERIVATIVE_BIT;
+					derived = true;
+				}
+				catch (const std::exception&) {}
+			}
+
+			std::shared_ptr<Pipeline> pipeline = nullptr;
+			try {
+				pipeline = std::make_shared<Pipeline>(device, vertFilepath, fragFilepath, *config);
+			}
+			catch (...) {
+				pendingCount--;
+				throw;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				lastFinished = Clock::now();
+			}
+			builtCount++;
+			if (derived) derivedCount++;
+			pendingCount--;
+			return pipeline;
+		}).share();
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		handles.push_back(handle);
+		return handle;
+	}
+
+	void PipelineBuilder::waitIdle() {
+		std::vector<Handle> waiting = {};
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			waiting = handles;
+		}
+		for (auto& handle : waiting) {
+			handle.wait();
+		}
+	}
+
+	double PipelineBuilder::getBuildTime() {
+		std::lock_guard<std::mutex> lock{ mutex };
+		if (builtCount == 0) return 0.0;
+		return std::chrono::duration<double, std::milli>(lastFinished - firstQueued).count();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+#include "pipeline.hpp"
+#include "threadpool.hpp"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace ToyBox {
+	// compiles pipelines on a worker pool: systems describe their pipelines up front and get a handle back right away,
+	// and the frame loop only waits on a handle the first time it needs that pipeline. shader modules and pipelines are
+	// created on the workers, which Vulkan allows since they only share the internally synchronized pipeline cache
+	class PipelineBuilder {
+	public:
+		using Handle = std::shared_future<std::shared_ptr<Pipeline>>;
+		using Clock = std::chrono::high_resolution_clock;
+
+		PipelineBuilder(Device& device, unsigned int threadCount = 0); // constructor, 0 threads means one per hardware thread
+		~PipelineBuilder(); // destructor, waits for the builds already running
+
+		// not copyable or movable
+		PipelineBuilder(const PipelineBuilder&) = delete;
+		PipelineBuilder& operator = (const PipelineBuilder&) = delete;
+
+		// queue a pipeline build; the config is heap allocated so the pointers between its members stay valid while it waits,
+		// and the handle rethrows if the pipeline couldn't be created. with a base, the pipeline is created as its derivative
+		// if the base has already been built when the build starts, or on its own if the base is still compiling or failed
+		Handle build(const std::string& vertFilepath, const std::string& fragFilepath, std::unique_ptr<PipelineConfigInfo> configInfo, Handle basePipeline = {});
+		void waitIdle(); // block until every queued build has finished
+
+		size_t getPendingCount() const { return pendingCount; } // builds queued or running
+		size_t getBuiltCount() const { return builtCount; }
+		size_t getDerivedCount() const { return derivedCount; } // builds created as derivatives of a finished base
+		unsigned int getThreadCount() const { return threadPool.getThreadCount(); }
+		double getBuildTime(); // milliseconds from the first build being queued until the last one finished
+
+	private:
+		Device& device; // a handle for the device instance
+		std::mutex mutex; // guards handles, firstQueued and lastFinished
+		std::vector<Handle> handles = {}; // a handle for every build, for waitIdle
+		Clock::time_point firstQueued = {}; // a handle for when the first build was queued
+		Clock::time_point lastFinished = {}; // a handle for when the newest build finished
+		std::atomic<size_t> pendingCount{ 0 }; // a handle for the number of unfinished builds
+		std::atomic<size_t> builtCount{ 0 }; // a handle for the number of finished builds
+		std::atomic<size_t> derivedCount{ 0 }; // a handle for the number of builds created as derivatives
+		ThreadPool threadPool; // declared last so the workers stop before the members they write to are destroyed
+	};
+}
\ No newline at end of file
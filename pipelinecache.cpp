@@ -0,0 +1,103 @@
+#include "pipelinecache.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace ToyBox {
+	PipelineCache::PipelineCache(VkDevice device, const VkPhysicalDeviceProperties& properties, const std::string& directory) : device{ device }, properties{ properties } {
+		// the name keeps caches of different gpus and drivers apart, the header check catches anything the name misses
+		std::ostringstream name;
+		name << std::hex << "pipeline_cache_" << properties.vendorID << "_" << properties.deviceID << "_" << properties.driverVersion << "_";
+		for (uint32_t i = 0; i < VK_UUID_SIZE; i++) {
+			name << (properties.pipelineCacheUUID[i] >> 4) << (properties.pipelineCacheUUID[i] & 0xf);
+		}
+		name << ".bin";
+		path = (std::filesystem::path(directory) / name.str()).string();
+
+		std::string data = {};
+		std::ifstream file{ path, std::ios::binary };
+		if (file.is_open()) {
+			std::ostringstream contents;
+			contents << file.rdbuf();
+			data = contents.str();
+			if (!isValid(data)) {
+				std::cout << "pipeline cache: discarding " << path << ", it was written for another device or driver" << std::endl;
+				data.clear();
+			}
+		}
+
+		VkPipelineCacheCreateInfo cacheInfo = {};
+		cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		cacheInfo.initialDataSize = data.size();
+		cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+		if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) != VK_SUCCESS) {
+			// the driver may still reject data that passed the header check, start from an empty cache instead
+			cacheInfo.initialDataSize = 0;
+			cacheInfo.pInitialData = nullptr;
+			data.clear();
+			if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create pipeline cache!");
+			}
+		}
+		loadedBytes = data.size();
+	}
+
+	PipelineCache::~PipelineCache() {
+		save();
+		vkDestroyPipelineCache(device, cache, nullptr);
+	}
+
+	bool PipelineCache::save() {
+		size_t size = 0;
+		if (vkGetPipelineCacheData(device, cache, &size, nullptr) != VK_SUCCESS || size == 0) return false;
+		std::vector<char> data(size);
+		if (vkGetPipelineCacheData(device, cache, &size, data.data()) != VK_SUCCESS) return false;
+
+		// write everything to a temporary file first, so a crash mid-write never leaves a truncated cache behind
+		std::string temporaryPath = path + ".tmp";
+		{
+			std::ofstream file{ temporaryPath, std::ios::binary | std::ios::trunc };
+			if (!file.write(data.data(), static_cast<std::streamsize>(size)) || !file.flush()) {
+				std::cerr << "pipeline cache: failed to write " << temporaryPath << std::endl;
+				return false;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(temporaryPath, path, error);
+		if (error) {
+			std::cerr << "pipeline cache: failed to replace " << path << ": " << error.message() << std::endl;
+			std::filesystem::remove(temporaryPath, error);
+			return false;
+		}
+		return true;
+	}
+
+	void PipelineCache::recordCreation(double milliseconds) {
+		std::lock_guard<std::mutex> lock{ statsMutex };
+		creationCount++;
+		creationTime += milliseconds;
+	}
+
+	void PipelineCache::printStats() {
+		std::lock_guard<std::mutex> lock{ statsMutex };
+		std::cout << "pipeline cache: " << creationCount << " pipelines created in " << creationTime << " ms of compile time with a "
+			<< (isWarm() ? "warm" : "cold") << " cache (" << loadedBytes / 1024.0 << " KB loaded from " << path << ")" << std::endl;
+	}
+
+	bool PipelineCache::isValid(const std::string& data) const {
+		VkPipelineCacheHeaderVersionOne header = {};
+		if (data.size() < sizeof(header)) return false;
+		std::memcpy(&header, data.data(), sizeof(header));
+
+		return header.headerSize >= sizeof(header) && header.headerSize <= data.size()
+			&& header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+			&& header.vendorID == properties.vendorID
+			&& header.deviceID == properties.deviceID
+			&& std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <mutex>
+#include <string>
+
+namespace ToyBox {
+	// one VkPipelineCache shared by every pipeline, loaded from a file named after the vendor, device and driver at startup
+	// and written back on shutdown, so pipelines compiled in an earlier run are fetched instead of compiled again.
+	// data whose header doesn't match this device and driver is discarded, and the file is replaced atomically.
+	// the VkPipelineCache itself is internally synchronized, so pipelines can be created through it from any thread
+	class PipelineCache {
+	public:
+		PipelineCache(VkDevice device, const VkPhysicalDeviceProperties& properties, const std::string& directory = "."); // constructor, loads the file if there is a valid one
+		~PipelineCache(); // destructor, saves the cache
+
+		// not copyable or movable
+		PipelineCache(const PipelineCache&) = delete;
+		PipelineCache& operator = (const PipelineCache&) = delete;
+
+		bool save(); // write the cache data to a temporary file and rename it over the cache file, false if that failed
+		void recordCreation(double milliseconds); // add a pipeline creation to the timings, from any thread
+		void printStats(); // print whether the cache was warm and the time spent creating pipelines so far
+
+		VkPipelineCache getCache() const { return cache; }
+		const std::string& getPath() const { return path; }
+		bool isWarm() const { return loadedBytes > 0; } // whether valid data from an earlier run was loaded
+		size_t getLoadedBytes() const { return loadedBytes; }
+
+	private:
+		bool isValid(const std::string& data) const; // check the header against this device and driver
+
+		VkDevice device; // a handle for the logical device
+		VkPhysicalDeviceProperties properties; // a handle for the properties the cache data must match
+		VkPipelineCache cache = VK_NULL_HANDLE; // a handle for the pipeline cache
+		std::string path; // a handle for the cache file
+		size_t loadedBytes = 0; // a handle for the bytes of valid data loaded at startup
+		std::mutex statsMutex; // guards creationCount and creationTime, pipelines are created on worker threads
+		uint32_t creationCount = 0; // a handle for the number of pipelines created
+		double creationTime = 0.0; // a handle for the milliseconds spent creating pipelines
+	};
+}
\ No newline at end of file
@@ -0,0 +1,153 @@
+#include "pipelineregistry.hpp"
+#include <stdexcept>
+#include <type_traits>
+
+namespace ToyBox {
+	namespace {
+		// append the bytes of a value to a key, only for types without padding
+		template <typename T>
+		void append(std::string& key, const T& value) {
+			static_assert(std::is_trivially_copyable<T>::value, "key fields must be plain data");
+			key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		void append(std::string& key, const std::string& value) {
+			append(key, value.size());
+			key.append(value);
+		}
+	}
+
+	PipelineRegistry::PipelineRegistry(Device& device, unsigned int threadCount) : device{ device }, builder{ device, threadCount } {}
+
+	PipelineRegistry::~PipelineRegistry() {
+		builder.waitIdle(); // running builds still use the layouts
+		for (auto& kv : layouts) {
+			vkDestroyPipelineLayout(device.getDevice(), kv.second, nullptr);
+		}
+	}
+
+	PipelineRegistry::Handle PipelineRegistry::getPipeline(const std::string& vertFilepath, const std::string& fragFilepath, std::unique_ptr<PipelineConfigInfo> configInfo) {
+		requestCount++;
+		std::string key = makeKey(vertFilepath, fragFilepath, *configInfo);
+		auto it = pipelines.find(key);
+		if (it != pipelines.end()) return it->second;
+
+		// drivers that make use of derivatives compile a child faster from a parent with the same layout and render pass
+		std::string familyKey = makeFamilyKey(*configInfo);
+		auto base = bases.find(familyKey);
+		Handle handle = {};
+		if (base == bases.end()) {
+			configInfo->createFlags |= VK_PIPELINE_CREATE_ALLOW_DERIVATIVES_BIT;
+			handle = builder.build(vertFilepath, fragFilepath, std::move(configInfo));
+			bases[familyKey] = handle;
+		}
+		else {
+			handle = builder.build(vertFilepath, fragFilepath, std::move(configInfo), base->second);
+			derivativeCount++;
+		}
+
+		pipelines[key] = handle;
+		return handle;
+	}
+
+	VkPipelineLayout PipelineRegistry::getPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges) {
+		std::string key = {};
+		append(key, setLayouts.size());
+		for (VkDescriptorSetLayout setLayout : setLayouts) append(key, setLayout);
+		for (const auto& range : pushConstantRanges) append(key, range);
+
+		auto it = layouts.find(key);
+		if (it != layouts.end()) return it->second;
+
+		// fill out the VkPipelineLayoutCreateInfo struct
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+		pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+		pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+		pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+		// create the pipeline layout
+		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+		if (vkCreatePipelineLayout(device.getDevice(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create pipeline layout!");
+		}
+		layouts[key] = pipelineLayout;
+		return pipelineLayout;
+	}
+
+	std::string PipelineRegistry::makeKey(const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo) {
+		std::string key = makeFamilyKey(configInfo);
+		append(key, vertFilepath);
+		append(key, fragFilepath);
+
+		// vertex input, whose description structs are all 32-bit fields
+		append(key, configInfo.bindingDescriptions.size());
+		for (const auto& binding : configInfo.bindingDescriptions) append(key, binding);
+		append(key, configInfo.attributeDescriptions.size());
+		for (const auto& attribute : configInfo.attributeDescriptions) append(key, attribute);
+
+		// fixed-function state, field by field so pointers and padding stay out of the key
+		append(key, configInfo.inputAssemblyInfo.topology);
+		append(key, configInfo.inputAssemblyInfo.primitiveRestartEnable);
+		append(key, configInfo.viewportInfo.viewportCount);
+		append(key, configInfo.viewportInfo.scissorCount);
+
+		const auto& rasterization = configInfo.rasterizationInfo;
+		append(key, rasterization.depthClampEnable);
+		append(key, rasterization.rasterizerDiscardEnable);
+		append(key, rasterization.polygonMode);
+		append(key, rasterization.cullMode);
+		append(key, rasterization.frontFace);
+		append(key, rasterization.depthBiasEnable);
+		append(key, rasterization.depthBiasConstantFactor);
+		append(key, rasterization.depthBiasClamp);
+		append(key, rasterization.depthBiasSlopeFactor);
+		append(key, rasterization.lineWidth);
+
+		const auto& multisample = configInfo.multisampleInfo;
+		append(key, multisample.rasterizationSamples);
+		append(key, multisample.sampleShadingEnable);
+		append(key, multisample.minSampleShading);
+		append(key, multisample.alphaToCoverageEnable);
+		append(key, multisample.alphaToOneEnable);
+
+		append(key, configInfo.colorBlendAttachment);
+		append(key, configInfo.colorBlendInfo.logicOpEnable);
+		append(key, configInfo.colorBlendInfo.logicOp);
+		append(key, configInfo.colorBlendInfo.attachmentCount);
+		append(key, configInfo.colorBlendInfo.blendConstants);
+
+		const auto& depthStencil = configInfo.depthStencilInfo;
+		append(key, depthStencil.depthTestEnable);
+		append(key, depthStencil.depthWriteEnable);
+		append(key, depthStencil.depthCompareOp);
+		append(key, depthStencil.depthBoundsTestEnable);
+		append(key, depthStencil.stencilTestEnable);
+		append(key, depthStencil.front);
+		append(key, depthStencil.back);
+		append(key, depthStencil.minDepthBounds);
+		append(key, depthStencil.maxDepthBounds);
+
+		append(key, configInfo.dynamicStateEnables.size());
+		for (VkDynamicState state : configInfo.dynamicStateEnables) append(key, state);
+
+		// the shader permutation
+		append(key, configInfo.specialization.entries.size());
+		for (const auto& entry : configInfo.specialization.entries) {
+			append(key, entry.constantID);
+			append(key, entry.offset);
+			append(key, entry.size);
+		}
+		key.append(configInfo.specialization.data.begin(), configInfo.specialization.data.end());
+		return key;
+	}
+
+	std::string PipelineRegistry::makeFamilyKey(const PipelineConfigInfo& configInfo) {
+		std::string key = {};
+		append(key, configInfo.pipelineLayout);
+		append(key, configInfo.renderPass);
+		append(key, configInfo.subpass);
+		return key;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+#include "pipelinebuilder.hpp"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ToyBox {
+	// hands out shared pipelines and pipeline layouts: a request is keyed on the shaders and every piece of state in its
+	// PipelineConfigInfo, so systems asking for identical pipelines share one VkPipeline instead of compiling it again.
+	// the first pipeline of each layout and render pass is built allowing derivatives, and the later ones derive from it once it has been built.
+	// only used from the main thread, the builds themselves run on the builder's workers
+	class PipelineRegistry {
+	public:
+		using Handle = PipelineBuilder::Handle;
+
+		PipelineRegistry(Device& device, unsigned int threadCount = 0); // constructor, 0 threads means one per hardware thread
+		~PipelineRegistry(); // destructor, waits for running builds and destroys the pipeline layouts
+
+		// not copyable or movable
+		PipelineRegistry(const PipelineRegistry&) = delete;
+		PipelineRegistry& operator = (const PipelineRegistry&) = delete;
+
+		// the pipeline for these shaders and state, queued on the builder the first time it's asked for
+		Handle getPipeline(const std::string& vertFilepath, const std::string& fragFilepath, std::unique_ptr<PipelineConfigInfo> configInfo);
+		// the layout for these descriptor set layouts and push constant ranges, owned by the registry
+		VkPipelineLayout getPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges);
+
+		PipelineBuilder& getBuilder() { return builder; }
+		size_t getPipelineCount() const { return pipelines.size(); } // distinct pipelines
+		uint64_t getRequestCount() const { return requestCount; } // pipelines asked for, including shared ones
+		uint64_t getDerivativeCount() const { return derivativeCount; } // pipelines requested with a base, see PipelineBuilder::getDerivedCount for those built as derivatives
+		size_t getLayoutCount() const { return layouts.size(); }
+
+	private:
+		static std::string makeKey(const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo); // every field that affects the pipeline
+		static std::string makeFamilyKey(const PipelineConfigInfo& configInfo); // layout and render pass, which derivatives must share with their base
+
+		Device& device; // a handle for the device instance
+		PipelineBuilder builder; // a handle for the builder the pipelines are compiled on
+		std::unordered_map<std::string, Handle> pipelines = {}; // a handle for the pipelines by key
+		std::unordered_map<std::string, Handle> bases = {}; // a handle for the base pipeline of each family
+		std::unordered_map<std::string, VkPipelineLayout> layouts = {}; // a handle for the pipeline layouts by key
+		uint64_t requestCount = 0; // a handle for the number of pipeline requests
+		uint64_t derivativeCount = 0; // a handle for the number of pipelines requested with a base
+	};
+}
\ No newline at end of file
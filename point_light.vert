@@ -1,4 +1,5 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
 
 const vec2 OFFSETS[6] = vec2[](
   vec2(-1.0, -1.0),
@@ -11,19 +12,7 @@ const vec2 OFFSETS[6] = vec2[](
 
 layout (location = 0) out vec2 fragOffset;
 
-struct PointLight {
-	vec4 position; 
-	vec4 color;
-};
-
-layout(set = 0, binding = 0) uniform GlobalUbo {
-	mat4 projection;
-	mat4 view;
-	mat4 invView;
-	vec4 ambientLightColor;
-	PointLight pointLights[10];
-	int numLights;
-} ubo;
+#include "global_ubo.glsl"
 
 layout(push_constant) uniform Push {
 	vec4 position;
@@ -13,16 +13,14 @@ namespace ToyBox {
 		float radius;
 	};
 
-	PointLightSystem::PointLightSystem(Device& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout) : device{ device } {
-		createPipelineLayout(globalSetLayout);
-		createPipeline(renderPass);
+	PointLightSystem::PointLightSystem(Device& device, PipelineRegistry& pipelineRegistry, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout) : device{ device } {
+		createPipelineLayout(pipelineRegistry, globalSetLayout);
+		createPipeline(pipelineRegistry, renderPass);
 	}
 
-	PointLightSystem::~PointLightSystem() {
-		vkDestroyPipelineLayout(device.getDevice(), pipelineLayout, nullptr);
-	}
+	PointLightSystem::~PointLightSystem() {}
 
-	void PointLightSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
+	void PointLightSystem::createPipelineLayout(PipelineRegistry& pipelineRegistry, VkDescriptorSetLayout globalSetLayout) {
 		// create a push constant range
 		VkPushConstantRange pushConstantRange = {};
 		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
@@ -31,31 +29,21 @@ namespace ToyBox {
 
 		std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout };
 
-		// fill out the VkPipelineLayoutCreateInfo struct
-		VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-		pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-		pipelineLayoutInfo.pushConstantRangeCount = 1;
-		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-
-		// create the pipeline layout
-		if (vkCreatePipelineLayout(device.getDevice(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create pipeline layout!");
-		}
+		// systems with the same descriptor set layouts and push constants share one layout
+		pipelineLayout = pipelineRegistry.getPipelineLayout(descriptorSetLayouts, { pushConstantRange });
 	}
 
-	void PointLightSystem::createPipeline(VkRenderPass renderPass) {
+	void PointLightSystem::createPipeline(PipelineRegistry& pipelineRegistry, VkRenderPass renderPass) {
 		assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
 		// create a config for the pipeline
-		PipelineConfigInfo pipelineConfig = {};
-		Pipeline::defaultPipelineConfigInfo(pipelineConfig);
-		pipelineConfig.attributeDescriptions.clear();
-		pipelineConfig.bindingDescriptions.clear();
-		pipelineConfig.renderPass = renderPass;
-		pipelineConfig.pipelineLayout = pipelineLayout;
-		pipeline = std::make_unique<Pipeline>(device, "point_light.vert.spv", "point_light.frag.spv", pipelineConfig);
+		auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+		Pipeline::defaultPipelineConfigInfo(*pipelineConfig);
+		pipelineConfig->attributeDescriptions.clear();
+		pipelineConfig->bindingDescriptions.clear();
+		pipelineConfig->renderPass = renderPass;
+		pipelineConfig->pipelineLayout = pipelineLayout;
+		pipelineHandle = pipelineRegistry.getPipeline("point_light.vert.spv", "point_light.frag.spv", std::move(pipelineConfig));
 	}
 
 	void PointLightSystem::update(FrameInfo& frameInfo, GlobalUbo& ubo) {
@@ -79,24 +67,35 @@ namespace ToyBox {
 		}
 
 		ubo.numLights = lightIndex;
+		frameInfo.lightCount = lightIndex;
 	}
 
 	void PointLightSystem::render(FrameInfo& frameInfo) {
-		pipeline->bind(frameInfo.commandBuffer);
-
-		vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet, 0, nullptr);
+		assert(frameInfo.recorder != nullptr && "Cannot render point lights without a recorder for their secondary command buffers");
+		if (!pipeline) pipeline = pipelineHandle.get(); // only waits if the build hasn't finished by the first frame
 
+		// the entity map can only be walked on this thread, the billboards are then recorded in ranges
+		lights.clear();
 		for (auto& kv : frameInfo.gameEntities) {
-			auto& entityInstance = kv.second;
-			if (entityInstance.pointLight == nullptr) continue;
+			if (kv.second.pointLight != nullptr) lights.push_back(&kv.second);
+		}
 
-			PointLightPushConstants push = {};
-			push.position = glm::vec4(entityInstance.transform.translation, 1.f);
-			push.color = glm::vec4(entityInstance.color, entityInstance.pointLight->lightIntensity);
-			push.radius = entityInstance.transform.scale.x;
+		frameInfo.recorder->record(frameInfo.commandBuffer, lights.size(), MIN_LIGHTS_PER_TASK, [&](VkCommandBuffer commandBuffer, size_t begin, size_t end, unsigned int) {
+			pipeline->bind(commandBuffer);
 
-			vkCmdPushConstants(frameInfo.commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PointLightPushConstants), &push);
-			vkCmdDraw(frameInfo.commandBuffer, 6, 1, 0, 0);
-		}
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet, 1, &frameInfo.globalUboOffset);
+
+			for (size_t i = begin; i < end; i++) {
+				const Entity& entityInstance = *lights[i];
+
+				PointLightPushConstants push = {};
+				push.position = glm::vec4(entityInstance.transform.translation, 1.f);
+				push.color = glm::vec4(entityInstance.color, entityInstance.pointLight->lightIntensity);
+				push.radius = entityInstance.transform.scale.x;
+
+				vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PointLightPushConstants), &push);
+				vkCmdDraw(commandBuffer, 6, 1, 0, 0);
+			}
+		});
 	}
 }
\ No newline at end of file
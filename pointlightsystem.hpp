@@ -1,6 +1,7 @@
 #pragma once
 #include "camera.hpp"
 #include "pipeline.hpp"
+#include "pipelineregistry.hpp"
 #include "device.hpp"
 #include "entity.hpp"
 #include "frameinfo.hpp"
@@ -10,7 +11,7 @@
 namespace ToyBox {
 	class PointLightSystem {
 	public:
-		PointLightSystem(Device& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout); // constructor
+		PointLightSystem(Device& device, PipelineRegistry& pipelineRegistry, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout); // constructor, requests the pipeline
 		~PointLightSystem(); // destructor
 
 		// not copyable or movable
@@ -20,12 +21,16 @@ namespace ToyBox {
 		void update(FrameInfo& frameInfo, GlobalUbo& ubo); // update the point light array
 		void render(FrameInfo& frameInfo); // render the entities
 
+		static constexpr size_t MIN_LIGHTS_PER_TASK = 256; // billboards worth recording into a secondary buffer of their own
+
 	private:
-		void createPipelineLayout(VkDescriptorSetLayout globalSetLayout); // create a pipeline layout
-		void createPipeline(VkRenderPass renderPass); // create a pipeline
+		void createPipelineLayout(PipelineRegistry& pipelineRegistry, VkDescriptorSetLayout globalSetLayout); // get the shared pipeline layout
+		void createPipeline(PipelineRegistry& pipelineRegistry, VkRenderPass renderPass); // request the pipeline
 
 		Device& device; // a handle for the device instance
-		std::unique_ptr<Pipeline> pipeline; // a handle for the pipeline instance
-		VkPipelineLayout pipelineLayout; // a handle for the pipeline layout
+		PipelineRegistry::Handle pipelineHandle; // a handle for the pipeline being built
+		std::shared_ptr<Pipeline> pipeline; // a handle for the pipeline instance, taken from its build the first time it's needed
+		VkPipelineLayout pipelineLayout; // a handle for the pipeline layout, owned by the pipeline registry
+		std::vector<const Entity*> lights = {}; // a handle for this frame's point light entities, kept to reuse its memory
 	};
 }
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include "queuetimeline.hpp"
+#include <stdexcept>
+
+namespace ToyBox {
+	QueueTimeline::QueueTimeline(VkDevice device, VkQueue queue) : device{ device }, queue{ queue } {
+		VkSemaphoreTypeCreateInfo typeInfo = {};
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		typeInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo semaphoreInfo = {};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreInfo.pNext = &typeInfo;
+		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create timeline semaphore!");
+		}
+	}
+
+	QueueTimeline::~QueueTimeline() {
+		waitIdle();
+		vkDestroySemaphore(device, semaphore, nullptr);
+	}
+
+	uint64_t QueueTimeline::submit(uint32_t commandBufferCount, const VkCommandBuffer* commandBuffers, const std::vector<Wait>& waits, const std::vector<VkSemaphore>& signalSemaphores) {
+		waitSemaphores.clear();
+		waitValues.clear();
+		waitStages.clear();
+		for (const auto& wait : waits) {
+			waitSemaphores.push_back(wait.semaphore);
+			waitValues.push_back(wait.value);
+			waitStages.push_back(wait.stage);
+		}
+
+		// the timeline goes first, binary semaphores take a value that is ignored
+		uint64_t value = lastSubmitted + 1;
+		signals.assign(1, semaphore);
+		signalValues.assign(1, value);
+		for (VkSemaphore signal : signalSemaphores) {
+			signals.push_back(signal);
+			signalValues.push_back(0);
+		}
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+		timelineInfo.pWaitSemaphoreValues = waitValues.data();
+		timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+		timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = &timelineInfo;
+		submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+		submitInfo.pWaitSemaphores = waitSemaphores.data();
+		submitInfo.pWaitDstStageMask = waitStages.data();
+		submitInfo.commandBufferCount = commandBufferCount;
+		submitInfo.pCommandBuffers = commandBuffers;
+		submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signals.size());
+		submitInfo.pSignalSemaphores = signals.data();
+		if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+			throw std::runtime_error("failed to submit to queue!");
+		}
+
+		lastSubmitted = value;
+		return value;
+	}
+
+	bool QueueTimeline::isComplete(uint64_t value) {
+		if (value <= completed) return true;
+		if (vkGetSemaphoreCounterValue(device, semaphore, &completed) != VK_SUCCESS) {
+			throw std::runtime_error("failed to read timeline semaphore!");
+		}
+		return value <= completed;
+	}
+
+	void QueueTimeline::wait(uint64_t value) {
+		if (value <= completed) return;
+
+		VkSemaphoreWaitInfo waitInfo = {};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &semaphore;
+		waitInfo.pValues = &value;
+		if (vkWaitSemaphores(device, &waitInfo, UINT64_MAX) != VK_SUCCESS) {
+			throw std::runtime_error("failed to wait on timeline semaphore!");
+		}
+		completed = value;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+
+namespace ToyBox {
+	// every submission to a queue goes through its timeline: each submit signals the next value of one timeline semaphore,
+	// so gpu progress is a single number that can be polled or waited on, and anything the gpu still reads can be tagged
+	// with the value after which it is safe to reuse. values complete in submission order. only used from the main thread
+	class QueueTimeline {
+	public:
+		// a semaphore a submission waits on; value is ignored for binary semaphores
+		struct Wait {
+			VkSemaphore semaphore = VK_NULL_HANDLE;
+			uint64_t value = 0;
+			VkPipelineStageFlags stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		};
+
+		QueueTimeline(VkDevice device, VkQueue queue); // constructor
+		~QueueTimeline(); // destructor, waits for everything submitted
+
+		// not copyable or movable
+		QueueTimeline(const QueueTimeline&) = delete;
+		QueueTimeline& operator = (const QueueTimeline&) = delete;
+
+		// submit command buffers after the waits, signalling the binary semaphores as well; returns the value the submission signals
+		uint64_t submit(uint32_t commandBufferCount, const VkCommandBuffer* commandBuffers, const std::vector<Wait>& waits = {}, const std::vector<VkSemaphore>& signalSemaphores = {});
+		Wait waitFor(uint64_t value, VkPipelineStageFlags stage) const { return { semaphore, value, stage }; } // for submissions on another queue that depend on this one
+
+		bool isComplete(uint64_t value); // true once the submission that signals value has finished, polls the semaphore only when needed
+		void wait(uint64_t value); // block until value has been signalled
+		void waitIdle() { wait(lastSubmitted); } // block until every submission has finished, without touching other queues
+
+		VkQueue getQueue() const { return queue; }
+		VkSemaphore getSemaphore() const { return semaphore; }
+		uint64_t getLastSubmitted() const { return lastSubmitted; } // value of the newest submission
+		uint64_t getCompleted() const { return completed; } // newest value known to have finished, as of the last poll or wait
+
+	private:
+		VkDevice device; // a handle for the logical device
+		VkQueue queue; // a handle for the queue submitted to
+		VkSemaphore semaphore = VK_NULL_HANDLE; // a handle for the timeline semaphore
+		uint64_t lastSubmitted = 0; // a handle for the value of the newest submission
+		uint64_t completed = 0; // a handle for the newest value known to have finished
+
+		// scratch arrays for building a submission without allocating every frame
+		std::vector<VkSemaphore> waitSemaphores = {};
+		std::vector<uint64_t> waitValues = {};
+		std::vector<VkPipelineStageFlags> waitStages = {};
+		std::vector<VkSemaphore> signals = {};
+		std::vector<uint64_t> signalValues = {};
+	};
+}
\ No newline at end of file
@@ -3,9 +3,10 @@
 #include <array>
 
 namespace ToyBox {
-	Renderer::Renderer(Window& window, Device& device) : window{ window }, device{ device } {
+	Renderer::Renderer(Window& window, Device& device, unsigned int recordThreads) : window{ window }, device{ device } {
 		recreateSwapChain();
 		createCommandBuffers();
+		recorder = std::make_unique<ParallelRecorder>(device, recordThreads);
 	}
 
 	Renderer::~Renderer() {
@@ -77,6 +78,7 @@ namespace ToyBox {
 		}
 
 		isFrameStarted = true; // the frame has started
+		recorder->beginFrame(currentFrameIndex); // the frame's last submission has finished, so its secondary buffers can be reset
 
 		// begin recording command buffers
 		auto commandBuffer = getCurrentCommandBuffer();		
@@ -132,20 +134,11 @@ namespace ToyBox {
 		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 		renderPassInfo.pClearValues = clearValues.data();
 
-		// record to our command buffer to begin the render pass
-		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-		// configure the dynamic viewport and scissor
-		VkViewport viewport = {};
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		viewport.width = static_cast<float>(swapChain->getSwapChainExtent().width);
-		viewport.height = static_cast<float>(swapChain->getSwapChainExtent().height);
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-		VkRect2D scissor{ {0, 0}, swapChain->getSwapChainExtent() };
-		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+		// record to our command buffer to begin the render pass, whose draws are recorded into secondary command buffers
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+		// dynamic state isn't inherited, so the recorder sets the viewport and scissor in every secondary buffer
+		recorder->beginRenderPass(renderPassInfo.renderPass, renderPassInfo.framebuffer, renderPassInfo.renderArea.extent);
 	}
 
 	void Renderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) {
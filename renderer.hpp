@@ -2,6 +2,7 @@
 #include "window.hpp"
 #include "device.hpp"
 #include "swapchain.hpp"
+#include "parallelrecorder.hpp"
 #include <cassert>
 #include <memory>
 #include <vector>
@@ -9,7 +10,7 @@
 namespace ToyBox {
 	class Renderer {
 	public:
-		Renderer(Window& window, Device& device); // constructor
+		Renderer(Window& window, Device& device, unsigned int recordThreads = 0); // constructor, 0 record threads means one per hardware thread
 		~Renderer(); // destructor
 
 		// not copyable or movable
@@ -18,7 +19,9 @@ namespace ToyBox {
 
 		VkRenderPass getSwapChainRenderPass() const { return swapChain->getRenderPass(); }
 		float getAspectRatio() const { return swapChain->extentAspectRatio(); }
+		VkExtent2D getSwapChainExtent() const { return swapChain->getSwapChainExtent(); }
 		bool isFrameInProgress() const { return isFrameStarted; }
+		ParallelRecorder& getRecorder() { return *recorder; } // records the render pass contents into secondary command buffers
 
 		VkCommandBuffer getCurrentCommandBuffer() const {
 			assert(isFrameStarted && "Cannot get command buffer when frame is not in progress");
@@ -32,7 +35,7 @@ namespace ToyBox {
 
 		VkCommandBuffer beginFrame(); // start a frame
 		VkCommandBuffer endFrame(); // end a frame
-		void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+		void beginSwapChainRenderPass(VkCommandBuffer commandBuffer); // its contents come from secondary command buffers recorded through getRecorder
 		void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
 
 	private:
@@ -44,8 +47,9 @@ namespace ToyBox {
 		Device& device; // a handle for the device instance
 		std::unique_ptr<SwapChain> swapChain; // a handle for the swap chain instance
 		std::vector<VkCommandBuffer> commandBuffers; // a handle for the command buffers
-		uint32_t currentImageIndex; // a handle for the index of the current image
-		int currentFrameIndex; // keep track of the frame index not tied to the image index
-		bool isFrameStarted; // check if the frame has began
+		std::unique_ptr<ParallelRecorder> recorder; // a handle for the secondary command buffer recorder
+		uint32_t currentImageIndex = 0; // a handle for the index of the current image
+		int currentFrameIndex = 0; // keep track of the frame index not tied to the image index
+		bool isFrameStarted = false; // check if the frame has began
 	};
 }
\ No newline at end of file
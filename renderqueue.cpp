@@ -0,0 +1,105 @@
+#include "renderqueue.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace ToyBox {
+	uint64_t RenderQueue::makeKey(uint32_t pipeline, uint32_t buffers, uint32_t mesh, float depth) {
+		// positive floats order like their bit patterns, so dropping the low mantissa bits keeps a 24-bit depth monotonic
+		uint32_t depthBits = 0;
+		depth = std::max(depth, 0.f);
+		std::memcpy(&depthBits, &depth, sizeof(depthBits));
+		depthBits >>= 32 - 1 - DEPTH_BITS;
+
+		uint64_t key = static_cast<uint64_t>(pipeline & ((1u << PIPELINE_BITS) - 1));
+		key = key << BUFFER_BITS | (buffers & ((1u << BUFFER_BITS) - 1));
+		key = key << MESH_BITS | (mesh & ((1u << MESH_BITS) - 1));
+		key = key << DEPTH_BITS | (depthBits & ((1u << DEPTH_BITS) - 1));
+		return key;
+	}
+
+	void RenderQueue::sort() {
+		unsortedStats = measure(packets);
+		sortPasses = 0;
+
+		// one pass over the keys fills the histograms of all eight bytes
+		std::array<std::array<uint32_t, 256>, 8> histograms = {};
+		for (const auto& packet : packets) {
+			for (uint32_t byte = 0; byte < 8; byte++) histograms[byte][(packet.key >> (byte * 8)) & 0xFF]++;
+		}
+
+		// least significant byte first, each pass a stable counting sort; a byte every key shares wouldn't move anything
+		scratch.resize(packets.size());
+		for (uint32_t byte = 0; byte < 8; byte++) {
+			auto& histogram = histograms[byte];
+			if (packets.empty() || histogram[(packets[0].key >> (byte * 8)) & 0xFF] == packets.size()) continue;
+
+			uint32_t offset = 0;
+			for (auto& count : histogram) {
+				uint32_t bucketCount = count;
+				count = offset;
+				offset += bucketCount;
+			}
+			for (const auto& packet : packets) scratch[histogram[(packet.key >> (byte * 8)) & 0xFF]++] = packet;
+			packets.swap(scratch);
+			sortPasses++;
+		}
+
+		sortedStats = measure(packets);
+	}
+
+	RenderQueue::Stats RenderQueue::measure(const std::vector<Packet>& packets) {
+		Stats stats = {};
+		for (size_t i = 0; i < packets.size(); i++) {
+			const uint64_t key = packets[i].key;
+			if (i == 0 || getPipeline(key) != getPipeline(packets[i - 1].key)) stats.pipelineBinds++;
+			if (i == 0 || getBuffers(key) != getBuffers(packets[i - 1].key)) stats.bufferBinds++;
+			if (i == 0 || getState(key) != getState(packets[i - 1].key)) stats.draws++;
+		}
+		return stats;
+	}
+
+	uint32_t RenderQueue::IdMap::get(uint64_t first, uint64_t second) {
+		if ((count + 1) * 2 > slots.size()) grow(); // at most half full, so probes stay short
+
+		const size_t mask = slots.size() - 1;
+		for (size_t index = hash(first, second) & mask;; index = (index + 1) & mask) {
+			Slot& slot = slots[index];
+			if (slot.generation != generation) {
+				slot = { first, second, count, generation };
+				return count++;
+			}
+			if (slot.first == first && slot.second == second) return slot.id;
+		}
+	}
+
+	void RenderQueue::IdMap::clear() {
+		count = 0;
+		if (++generation != 0) return;
+
+		// the stamp wrapped around, so old slots could pass for new ones
+		for (auto& slot : slots) slot.generation = 0;
+		generation = 1;
+	}
+
+	size_t RenderQueue::IdMap::hash(uint64_t first, uint64_t second) {
+		// pointers and handles share their low bits, so both halves are mixed down (the finalizer of splitmix64)
+		uint64_t value = first * 0x9E3779B97F4A7C15ull ^ second;
+		value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+		value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+		return static_cast<size_t>(value ^ (value >> 31));
+	}
+
+	void RenderQueue::IdMap::grow() {
+		std::vector<Slot> old = {};
+		old.swap(slots);
+		slots.resize(std::max<size_t>(64, old.size() * 2));
+
+		const size_t mask = slots.size() - 1;
+		for (const auto& slot : old) {
+			if (slot.generation != generation) continue;
+			size_t index = hash(slot.first, slot.second) & mask;
+			while (slots[index].generation == generation) index = (index + 1) & mask;
+			slots[index] = slot;
+		}
+	}
+}
\ No newline at end of file
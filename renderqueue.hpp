@@ -0,0 +1,83 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ToyBox {
+	// draw packets a system submits each frame, each a 64-bit sort key and the index of the submitter's own draw data. the key
+	// packs, from the most significant bits down, the pipeline, the vertex and index buffers, the mesh and the front-to-back
+	// depth, so radix sorting the keys puts draws sharing state next to each other and binds change as rarely as possible.
+	// sort measures the binds and draws a single stream would emit in submission order and in sorted order
+	class RenderQueue {
+	public:
+		static constexpr uint32_t PIPELINE_BITS = 12;
+		static constexpr uint32_t BUFFER_BITS = 12;
+		static constexpr uint32_t MESH_BITS = 16;
+		static constexpr uint32_t DEPTH_BITS = 24;
+
+		// a draw to sort, item is whatever index the submitter finds its data with
+		struct Packet {
+			uint64_t key = 0;
+			uint32_t item = 0;
+		};
+
+		// the state changes of a packet order, with adjacent packets of the same mesh drawn as one instanced draw
+		struct Stats {
+			uint32_t pipelineBinds = 0;
+			uint32_t bufferBinds = 0;
+			uint32_t draws = 0;
+		};
+
+		// hands out the dense ids the key fields are filled with, one per distinct pair of 64-bit values (a model and lod, two
+		// buffer handles). an open addressing table whose slots are kept between frames, and clear only bumps a generation
+		class IdMap {
+		public:
+			uint32_t get(uint64_t first, uint64_t second); // the pair's id, the next unused one the first time it's seen since clear
+			void clear(); // forget every pair, keeping the memory
+			uint32_t size() const { return count; }
+
+		private:
+			// a pair and its id, empty unless stamped with the current generation
+			struct Slot {
+				uint64_t first = 0;
+				uint64_t second = 0;
+				uint32_t id = 0;
+				uint32_t generation = 0;
+			};
+
+			static size_t hash(uint64_t first, uint64_t second);
+			void grow(); // double the slots and reinsert this generation's pairs
+
+			std::vector<Slot> slots = {}; // a handle for the table, a power of two long
+			uint32_t count = 0; // a handle for the pairs seen since clear
+			uint32_t generation = 1; // a handle for the stamp of the pairs seen since clear
+		};
+
+		// ids wider than their field are wrapped, which only costs extra binds; a negative depth sorts as 0
+		static uint64_t makeKey(uint32_t pipeline, uint32_t buffers, uint32_t mesh, float depth);
+		static uint32_t getPipeline(uint64_t key) { return static_cast<uint32_t>(key >> (BUFFER_BITS + MESH_BITS + DEPTH_BITS)); }
+		static uint32_t getBuffers(uint64_t key) { return static_cast<uint32_t>(key >> (MESH_BITS + DEPTH_BITS)) & ((1u << BUFFER_BITS) - 1); }
+		static uint64_t getState(uint64_t key) { return key >> DEPTH_BITS; } // everything but the depth, equal for packets one draw can cover
+
+		void clear() { packets.clear(); }
+		void submit(uint64_t key, uint32_t item) { packets.push_back({ key, item }); }
+		void sort(); // radix sort the packets by key, keeping submission order between equal keys
+
+		size_t size() const { return packets.size(); }
+		bool empty() const { return packets.empty(); }
+		const Packet& operator [] (size_t index) const { return packets[index]; }
+		const Stats& getUnsortedStats() const { return unsortedStats; } // last sort's packets in submission order
+		const Stats& getSortedStats() const { return sortedStats; } // last sort's packets in key order
+		uint32_t getSortPasses() const { return sortPasses; } // byte passes the last sort needed, constant bytes are skipped
+
+	private:
+		static Stats measure(const std::vector<Packet>& packets); // count the state changes of emitting packets in order
+
+		std::vector<Packet> packets = {}; // a handle for this frame's packets, kept to reuse its memory
+		std::vector<Packet> scratch = {}; // a handle for the other buffer of the radix sort
+		Stats unsortedStats = {}; // a handle for the state changes before the last sort
+		Stats sortedStats = {}; // a handle for the state changes after the last sort
+		uint32_t sortPasses = 0; // a handle for the byte passes of the last sort
+	};
+}
\ No newline at end of file
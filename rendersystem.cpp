@@ -1,77 +1,389 @@
 #include "rendersystem.hpp"
+#include "gpuscene.hpp"
+#include "meshletbuilder.hpp"
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 #include <stdexcept>
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
 
 namespace ToyBox {
-	struct SimplePushConstantData {
-		glm::mat4 modelMatrix{ 1.f };
-		glm::mat4 normalMatrix{ 1.f };
-	};
-
-	RenderSystem::RenderSystem(Device& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout) : device{ device } {
-		createPipelineLayout(globalSetLayout);
-		createPipeline(renderPass);
+	// a buffer handle as an integer, whether the platform defines non-dispatchable handles as pointers or as 64-bit integers
+	static uint64_t handleBits(VkBuffer buffer) {
+		uint64_t bits = 0;
+		std::memcpy(&bits, &buffer, sizeof(buffer));
+		return bits;
 	}
 
-	RenderSystem::~RenderSystem() {
-		vkDestroyPipelineLayout(device.getDevice(), pipelineLayout, nullptr);
+	RenderSystem::RenderSystem(Device& device, PipelineRegistry& pipelineRegistry, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout) : device{ device } {
+		createPipelineLayout(pipelineRegistry, globalSetLayout);
+		createPipeline(pipelineRegistry, renderPass);
 	}
 
-	void RenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
-		// create a push constant range
-		VkPushConstantRange pushConstantRange = {};
-		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-		pushConstantRange.offset = 0;
-		pushConstantRange.size = sizeof(SimplePushConstantData);
+	RenderSystem::~RenderSystem() {}
 
+	void RenderSystem::createPipelineLayout(PipelineRegistry& pipelineRegistry, VkDescriptorSetLayout globalSetLayout) {
 		std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout };
 
-		// fill out the VkPipelineLayoutCreateInfo struct
-		VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-		pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-		pipelineLayoutInfo.pushConstantRangeCount = 1;
-		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-
-		// create the pipeline layout
-		if (vkCreatePipelineLayout(device.getDevice(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create pipeline layout!");
-		}
+		// the matrices come in as instance data, so there are no push constants; systems with the same layouts share one
+		pipelineLayout = pipelineRegistry.getPipelineLayout(descriptorSetLayouts, {});
 	}
 
-	void RenderSystem::createPipeline(VkRenderPass renderPass) {
+	void RenderSystem::createPipeline(PipelineRegistry& pipelineRegistry, VkRenderPass renderPass) {
 		assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
-		// create a config for the pipeline
-		PipelineConfigInfo pipelineConfig = {};
-		Pipeline::defaultPipelineConfigInfo(pipelineConfig);
-		pipelineConfig.renderPass = renderPass;
-		pipelineConfig.pipelineLayout = pipelineLayout;
-		pipeline = std::make_unique<Pipeline>(device, "simple_shader.vert.spv", "simple_shader.frag.spv", pipelineConfig);
+		// every permutation is queued up front so switching variants between frames never waits on a compile
+		for (Model::VertexFormat vertexFormat : { Model::VertexFormat::Float, Model::VertexFormat::Packed }) {
+			for (size_t lightBucket = 0; lightBucket < LIGHT_BUCKETS.size(); lightBucket++) {
+				for (bool specularVariant : { true, false }) {
+					// create a config for the pipeline
+					auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+					Pipeline::defaultPipelineConfigInfo(*pipelineConfig);
+					pipelineConfig->renderPass = renderPass;
+					pipelineConfig->pipelineLayout = pipelineLayout;
+					pipelineConfig->specialization.set(0, LIGHT_BUCKETS[lightBucket]); // LIGHT_COUNT
+					pipelineConfig->specialization.set(1, static_cast<VkBool32>(specularVariant)); // SPECULAR
+					backFaceCulling = (pipelineConfig->rasterizationInfo.cullMode & VK_CULL_MODE_BACK_BIT) != 0;
+
+					// the packed variants read Model::PackedVertex
+					std::string vertFilepath = "simple_shader.vert.spv";
+					if (vertexFormat == Model::VertexFormat::Packed) {
+						pipelineConfig->bindingDescriptions = Model::PackedVertex::getBindingDescriptions();
+						pipelineConfig->attributeDescriptions = Model::PackedVertex::getAttributeDescriptions();
+						vertFilepath = "simple_shader_packed.vert.spv";
+					}
+
+					// the instance data follows the vertices in binding 1
+					auto instanceBindings = InstanceData::getBindingDescriptions();
+					auto instanceAttributes = InstanceData::getAttributeDescriptions();
+					pipelineConfig->bindingDescriptions.insert(pipelineConfig->bindingDescriptions.end(), instanceBindings.begin(), instanceBindings.end());
+					pipelineConfig->attributeDescriptions.insert(pipelineConfig->attributeDescriptions.end(), instanceAttributes.begin(), instanceAttributes.end());
+
+					Variant& variant = variants[permutationKey(vertexFormat, lightBucket, specularVariant)];
+					variant.handle = pipelineRegistry.getPipeline(vertFilepath, "simple_shader.frag.spv", std::move(pipelineConfig));
+				}
+			}
+		}
+	}
+
+	uint32_t RenderSystem::permutationKey(Model::VertexFormat vertexFormat, size_t lightBucket, bool specular) {
+		return static_cast<uint32_t>(vertexFormat) << 8 | static_cast<uint32_t>(lightBucket) << 1 | (specular ? 1u : 0u);
+	}
+
+	size_t RenderSystem::selectLightBucket(int lightCount) {
+		for (size_t lightBucket = 0; lightBucket < LIGHT_BUCKETS.size(); lightBucket++) {
+			if (lightCount <= LIGHT_BUCKETS[lightBucket]) return lightBucket;
+		}
+		return LIGHT_BUCKETS.size() - 1;
+	}
+
+	Pipeline* RenderSystem::getVariant(Model::VertexFormat vertexFormat, size_t lightBucket) {
+		Variant& variant = variants.at(permutationKey(vertexFormat, lightBucket, specular));
+		if (!variant.pipeline) variant.pipeline = variant.handle.get(); // only waits if the build hasn't finished by the first frame it's used
+		return variant.pipeline.get();
+	}
+
+	void RenderSystem::cullEntities(FrameInfo& frameInfo) {
+		if (gpuScene) gpuScene->cull(frameInfo, lodThreshold);
 	}
 
 	void RenderSystem::renderEntities(FrameInfo& frameInfo) {
-		pipeline->bind(frameInfo.commandBuffer);
+		// timed as a whole, the parallel parts and the serial ones between them, so the scaling with threads shows in one number
+		const auto startTime = std::chrono::high_resolution_clock::now();
+		if (gpuScene) {
+			renderGpuScene(frameInfo);
+		}
+		else {
+			recordEntities(frameInfo);
+		}
+		recordMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	}
+
+	void RenderSystem::recordEntities(FrameInfo& frameInfo) {
 
-		vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet, 0, nullptr);
+		assert(frameInfo.recorder != nullptr && "Cannot render entities without a recorder for their secondary command buffers");
+		ParallelRecorder& recorder = *frameInfo.recorder;
+		const Frustum frustum = frameInfo.camera.getFrustum();
+		const glm::vec3 cameraPosition = frameInfo.camera.getPosition();
+		drawCount = 0;
+		instanceCount = 0;
+		queue.clear();
 
-		// loop through all entities and record their binds and draws to the command buffer
+		// gather the entities with a model
+		drawItems.clear();
 		for (auto& kv : frameInfo.gameEntities) {
 			auto& entity = kv.second;
 			if (entity.model == nullptr) continue;
-			SimplePushConstantData push = {};
-			push.modelMatrix = entity.transform.mat4();
-			push.normalMatrix = entity.transform.normalMatrix();
 
-			vkCmdPushConstants(frameInfo.commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SimplePushConstantData), &push);
+			DrawItem item = {};
+			item.model = entity.model.get();
+			item.transform = &entity.transform;
+			drawItems.push_back(item);
+		}
+
+		// their matrices, world space bounding spheres, depths and lods, split across the workers since each item only writes its own slots
+		bounds.resize(drawItems.size());
+		recorder.forEachRange(drawItems.size(), MIN_ITEMS_PER_TASK, [&](size_t begin, size_t end, unsigned int) {
+			for (size_t i = begin; i < end; i++) {
+				DrawItem& item = drawItems[i];
+				item.modelMatrix = item.transform->mat4();
+				item.normalMatrix = item.transform->normalMatrix();
+				const float scale = glm::max(glm::length(glm::vec3(item.modelMatrix[0])), glm::max(glm::length(glm::vec3(item.modelMatrix[1])), glm::length(glm::vec3(item.modelMatrix[2]))));
+				const glm::vec3 center{ item.modelMatrix * glm::vec4(item.model->getBoundsCenter(), 1.f) };
+				const float radius = item.model->getBoundsRadius() * scale;
+				bounds.set(i, center, radius);
+				item.depth = glm::length(center - cameraPosition) - radius;
+				item.lod = selectLod(*item.model, item.modelMatrix, frameInfo);
+				item.meshlets = item.lod == 0 && meshletCulling && !item.model->getMeshlets().empty();
+			}
+		});
+
+		// cull them all in one pass, then keep the visible ones whose geometry is resident
+		frustum.intersectSpheres(bounds, boundsVisible);
+		visibleCount = 0;
+		size_t kept = 0;
+		for (size_t i = 0; i < drawItems.size(); i++) {
+			if (!boundsVisible[i]) continue;
+			visibleCount++;
+
+			// only visible models count as used, evicted ones are streamed back in and skipped until their upload lands
+			DrawItem& item = drawItems[i];
+			bool resident = residencyManager ? residencyManager->request(*item.model) : item.model->isResident();
+			if (!resident) continue;
+			drawItems[kept++] = item;
+		}
+		culledCount = static_cast<uint32_t>(drawItems.size()) - visibleCount;
+		drawItems.resize(kept);
+		if (drawItems.empty()) return;
+
+		// queue the items keyed by variant, arena buffers, model and lod, then front to back so instances fill in nearest first.
+		// the ids are handed out in the order the entities come in, they only need to tell this frame's states apart
+		const size_t lightBucket = selectLightBucket(frameInfo.lightCount);
+		bufferIds.clear();
+		meshIds.clear();
+		for (size_t i = 0; i < drawItems.size(); i++) {
+			const DrawItem& item = drawItems[i];
+			const uint32_t pipelineId = permutationKey(item.model->getVertexFormat(), lightBucket, specular);
+			const uint32_t buffersId = bufferIds.get(handleBits(item.model->getVertexBuffer()), handleBits(item.model->getIndexBuffer()));
+			const uint32_t meshId = meshIds.get(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(item.model)), item.lod);
+			queue.submit(RenderQueue::makeKey(pipelineId, buffersId, meshId, item.depth), static_cast<uint32_t>(i));
+		}
+		queue.sort();
+		instanceCount = static_cast<uint32_t>(queue.size());
+
+		// split the queue into draws; large groups are cut into several instanced draws so the workers get similar shares.
+		// the variants are resolved here since getVariant may wait on a build and isn't safe to call from the workers
+		const uint32_t maxInstances = static_cast<uint32_t>(std::max<size_t>(MIN_INSTANCES_PER_DRAW, queue.size() / (recorder.getThreadCount() * MIN_DRAWS_PER_TASK)));
+		draws.clear();
+		uint32_t first = 0;
+		while (first < instanceCount) {
+			const DrawItem& item = drawItems[queue[first].item];
 
-			entity.model->bind(frameInfo.commandBuffer);
-			entity.model->draw(frameInfo.commandBuffer);
+			// meshlets are culled against each entity's own transform, so those entities are drawn one at a time
+			uint32_t count = 1;
+			if (!item.meshlets) {
+				// compared directly rather than through the key, whose ids wrap once a frame has more meshes than fit in their field
+				while (first + count < instanceCount && count < maxInstances) {
+					const DrawItem& next = drawItems[queue[first + count].item];
+					if (next.model != item.model || next.lod != item.lod) break;
+					count++;
+				}
+			}
+			draws.push_back({ first, count, getVariant(item.model->getVertexFormat(), lightBucket) });
+			first += count;
 		}
+
+		// the instance data is written in queue order, so a draw's instances are a contiguous range starting at its first packet
+		Buffer& instances = reserveInstances(frameInfo.frameIndex, queue.size());
+		InstanceData* instanceData = static_cast<InstanceData*>(instances.getMappedMemory());
+		VkBuffer instanceBuffer = instances.getBuffer();
+		VkDeviceSize instanceOffset = 0;
+
+		std::atomic<uint32_t> recordedDraws{ 0 };
+		recorder.record(frameInfo.commandBuffer, draws.size(), MIN_DRAWS_PER_TASK, [&](VkCommandBuffer commandBuffer, size_t begin, size_t end, unsigned int) {
+			// each range writes the instance data of its own draws
+			for (size_t i = draws[begin].first; i < draws[end - 1].first + draws[end - 1].count; i++) {
+				const DrawItem& item = drawItems[queue[i].item];
+				instanceData[i].modelMatrix = item.modelMatrix * item.model->getPositionDequantization();
+				instanceData[i].normalMatrix = glm::mat4(item.normalMatrix);
+			}
+
+			// every variant shares the layout, so the descriptor set and instance buffer stay bound across pipeline switches
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet, 1, &frameInfo.globalUboOffset);
+			vkCmdBindVertexBuffers(commandBuffer, 1, 1, &instanceBuffer, &instanceOffset);
+
+			// models are suballocated from the shared geometry arena, so the buffers only need rebinding when a model lives in another pool;
+			// nothing is inherited from the other secondary buffers, so each range binds from scratch
+			Pipeline* boundPipeline = nullptr;
+			VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+			VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+			uint32_t rangeDraws = 0;
+			for (size_t d = begin; d < end; d++) {
+				const Draw& draw = draws[d];
+				const DrawItem& item = drawItems[queue[draw.first].item];
+				if (draw.pipeline != boundPipeline) {
+					boundPipeline = draw.pipeline;
+					boundPipeline->bind(commandBuffer);
+				}
+
+				if (item.model->getVertexBuffer() != boundVertexBuffer || item.model->getIndexBuffer() != boundIndexBuffer) {
+					item.model->bind(commandBuffer);
+					boundVertexBuffer = item.model->getVertexBuffer();
+					boundIndexBuffer = item.model->getIndexBuffer();
+				}
+
+				if (item.meshlets) {
+					rangeDraws += drawMeshlets(commandBuffer, frameInfo, *item.model, item.modelMatrix, item.normalMatrix, frustum, draw.first);
+					continue;
+				}
+				item.model->draw(commandBuffer, item.lod, draw.count, draw.first);
+				rangeDraws++;
+			}
+			recordedDraws += rangeDraws;
+		});
+		drawCount = recordedDraws;
+	}
+
+	void RenderSystem::renderGpuScene(FrameInfo& frameInfo) {
+		assert(frameInfo.recorder != nullptr && "Cannot render the gpu scene without a recorder for its secondary command buffer");
+		drawCount = 0;
+		instanceCount = gpuScene->getObjectCount(); // before culling, the visible count only exists on the gpu
+		visibleCount = 0;
+		culledCount = 0;
+
+		// a draw per batch is too little to split, but the render pass only takes secondary buffers
+		const size_t lightBucket = selectLightBucket(frameInfo.lightCount);
+		const auto& batches = gpuScene->getBatches();
+		std::vector<Pipeline*> batchPipelines = {};
+		for (const auto& batch : batches) batchPipelines.push_back(getVariant(batch.vertexFormat, lightBucket));
+
+		frameInfo.recorder->record(frameInfo.commandBuffer, 1, 1, [&](VkCommandBuffer commandBuffer, size_t, size_t, unsigned int) {
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet, 1, &frameInfo.globalUboOffset);
+
+			// every object's instance data stays in the scene's buffer, each draw command picks its object with the first instance
+			VkBuffer instanceBuffer = gpuScene->getInstanceBuffer();
+			VkDeviceSize instanceOffset = 0;
+			vkCmdBindVertexBuffers(commandBuffer, 1, 1, &instanceBuffer, &instanceOffset);
+
+			Pipeline* boundPipeline = nullptr;
+			for (size_t i = 0; i < batches.size(); i++) {
+				const auto& batch = batches[i];
+				if (batchPipelines[i] != boundPipeline) {
+					boundPipeline = batchPipelines[i];
+					boundPipeline->bind(commandBuffer);
+				}
+
+				// the commands carry each model's offsets into the shared arena buffers
+				VkDeviceSize vertexOffset = 0;
+				vkCmdBindVertexBuffers(commandBuffer, 0, 1, &batch.vertexBuffer, &vertexOffset);
+				vkCmdBindIndexBuffer(commandBuffer, batch.indexBuffer, 0, batch.indexType);
+				vkCmdDrawIndexedIndirectCount(commandBuffer, gpuScene->getDrawCommandBuffer(), batch.commandOffset, gpuScene->getCountBuffer(), batch.countOffset,
+					gpuScene->getCapacity(), sizeof(VkDrawIndexedIndirectCommand));
+			}
+		});
+		drawCount = static_cast<uint32_t>(batches.size());
+	}
+
+	uint32_t RenderSystem::drawMeshlets(VkCommandBuffer commandBuffer, const FrameInfo& frameInfo, Model& model, const glm::mat4& modelMatrix, const glm::mat3& normalMatrix, const Frustum& frustum, uint32_t instance) const {
+		const glm::vec3 cameraPosition = frameInfo.camera.getPosition();
+		const glm::vec3 axisScale{ glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2])) };
+		const float scale = glm::max(axisScale.x, glm::max(axisScale.y, axisScale.z));
+
+		// normal cones only stay valid under uniform scaling, and only drop what the rasterizer would cull anyway when the
+		// pipelines cull back faces; otherwise only the frustum test is used
+		const bool uniformScale = glm::abs(axisScale.x - axisScale.y) <= 0.01f * scale && glm::abs(axisScale.x - axisScale.z) <= 0.01f * scale;
+		const bool coneCulling = uniformScale && backFaceCulling;
+
+		// visible meshlets next to each other in the index buffer are drawn with a single call
+		uint32_t draws = 0;
+		auto drawRun = [&](uint32_t firstIndex, uint32_t indexCount) {
+			model.drawRange(commandBuffer, firstIndex, indexCount, 1, instance);
+			draws++;
+		};
+		uint32_t runStart = 0, runCount = 0;
+		for (const auto& meshlet : model.getMeshlets()) {
+			glm::vec3 center{ modelMatrix * glm::vec4(meshlet.center, 1.f) };
+			float coneCutoff = coneCulling ? meshlet.coneCutoff : 1.f;
+			glm::vec3 coneAxis = coneCutoff < 1.f ? glm::normalize(normalMatrix * meshlet.coneAxis) : meshlet.coneAxis;
+			if (MeshletBuilder::isCulled(frustum, cameraPosition, center, meshlet.radius * scale, coneAxis, coneCutoff)) continue;
+
+			if (runCount > 0 && runStart + runCount == meshlet.firstIndex) {
+				runCount += meshlet.indexCount;
+				continue;
+			}
+			if (runCount > 0) drawRun(runStart, runCount);
+			runStart = meshlet.firstIndex;
+			runCount = meshlet.indexCount;
+		}
+		if (runCount > 0) drawRun(runStart, runCount);
+		return draws;
+	}
+
+	uint32_t RenderSystem::selectLod(const Model& model, const glm::mat4& modelMatrix, const FrameInfo& frameInfo) const {
+		const auto& lods = model.getLods();
+		if (lods.size() < 2 || frameInfo.extent.height == 0) return 0;
+
+		// lod errors are in model units, so scale them by the largest axis scale of the entity
+		const float scale = glm::max(glm::length(glm::vec3(modelMatrix[0])), glm::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+		const glm::mat4& projection = frameInfo.camera.getProjection();
+
+		// projection[1][1] maps a length at unit depth to half the viewport height; perspective projections divide by the depth,
+		// for which the distance to the near side of the bounding sphere is used so the estimate stays conservative
+		float pixelsPerUnit = projection[1][1] * 0.5f * static_cast<float>(frameInfo.extent.height);
+		if (projection[2][3] != 0.f) {
+			glm::vec3 cameraPosition{ frameInfo.camera.getInverseView()[3] };
+			glm::vec3 center{ modelMatrix * glm::vec4(model.getBoundsCenter(), 1.f) };
+			float distance = glm::length(center - cameraPosition) - model.getBoundsRadius() * scale;
+			if (distance <= 0.f) return 0;
+			pixelsPerUnit /= distance;
+		}
+
+		for (uint32_t lod = static_cast<uint32_t>(lods.size()) - 1; lod > 0; lod--) {
+			if (lods[lod].error * scale * glm::abs(pixelsPerUnit) <= lodThreshold) return lod;
+		}
+		return 0;
+	}
+
+	Buffer& RenderSystem::reserveInstances(int frameIndex, size_t count) {
+		// kept out of the frame ring, whose partitions have a fixed size, since the instance data grows with the entities drawn.
+		// the frame's fence has signalled, so its buffer can be replaced; it doubles so growing stays rare
+		std::unique_ptr<Buffer>& buffer = instanceBuffers[frameIndex];
+		if (buffer && buffer->getInstanceCount() >= count) return *buffer;
+
+		uint32_t capacity = buffer ? buffer->getInstanceCount() : MIN_INSTANCE_CAPACITY;
+		while (capacity < count) capacity *= 2;
+		buffer = std::make_unique<Buffer>(device, sizeof(InstanceData), capacity, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		if (buffer->map() != VK_SUCCESS) {
+			throw std::runtime_error("failed to map instance buffer!");
+		}
+		return *buffer;
+	}
+
+	std::vector<VkVertexInputBindingDescription> RenderSystem::InstanceData::getBindingDescriptions() {
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+		bindingDescriptions[0].binding = 1;
+		bindingDescriptions[0].stride = sizeof(InstanceData);
+		bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+		return bindingDescriptions;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> RenderSystem::InstanceData::getAttributeDescriptions() {
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions = {};
+
+		// a mat4 attribute takes a location per column, after the vertex attributes
+		for (uint32_t column = 0; column < 4; column++) {
+			attributeDescriptions.push_back({ 4 + column, 1, VK_FORMAT_R32G32B32A32_SFLOAT, static_cast<uint32_t>(offsetof(InstanceData, modelMatrix) + column * sizeof(glm::vec4)) });
+		}
+		for (uint32_t column = 0; column < 4; column++) {
+			attributeDescriptions.push_back({ 8 + column, 1, VK_FORMAT_R32G32B32A32_SFLOAT, static_cast<uint32_t>(offsetof(InstanceData, normalMatrix) + column * sizeof(glm::vec4)) });
+		}
+
+		return attributeDescriptions;
 	}
 }
\ No newline at end of file
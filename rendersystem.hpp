@@ -1,30 +1,117 @@
 #pragma once
+#include "buffer.hpp"
 #include "camera.hpp"
 #include "pipeline.hpp"
+#include "pipelineregistry.hpp"
 #include "device.hpp"
 #include "entity.hpp"
 #include "frameinfo.hpp"
+#include "renderqueue.hpp"
+#include "residencymanager.hpp"
+#include "swapchain.hpp"
+#include <array>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace ToyBox {
+	class GpuScene;
+
 	class RenderSystem {
 	public:
-		RenderSystem(Device& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout); // constructor
+		// per-instance vertex data read by simple_shader.vert from binding 1, written into the frame's instance buffer every frame
+		struct InstanceData {
+			glm::mat4 modelMatrix{ 1.f }; // includes the position dequantization of packed models
+			glm::mat4 normalMatrix{ 1.f };
+			static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+			static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+		};
+
+		RenderSystem(Device& device, PipelineRegistry& pipelineRegistry, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout); // constructor, requests the pipelines
 		~RenderSystem(); // destructor
 
 		// not copyable or movable
 		RenderSystem(const RenderSystem&) = delete;
 		RenderSystem& operator = (const RenderSystem&) = delete;
 
-		void renderEntities(FrameInfo& frameInfo); // render the entities
+		void cullEntities(FrameInfo& frameInfo); // record the gpu scene's culling pass before the render pass begins, nothing without a gpu scene
+		void renderEntities(FrameInfo& frameInfo); // render the entities, through the gpu scene when there is one
+		void setLodThreshold(float pixels) { lodThreshold = pixels; } // the largest lod error allowed on screen, in pixels
+		void setMeshletCulling(bool enabled) { meshletCulling = enabled; } // cull the meshlets of full detail models on the cpu, by their normal cones too if the pipelines cull back faces
+		void setResidencyManager(ResidencyManager* manager) { residencyManager = manager; } // report drawn models so idle ones can be evicted
+		void setSpecular(bool enabled) { specular = enabled; } // draw with the variants that compute specular highlights
+		void setGpuScene(GpuScene* scene) { gpuScene = scene; } // cull and draw on the gpu from the scene's objects instead of walking the entities
+		uint32_t getDrawCount() const { return drawCount; } // draw calls recorded last frame
+		uint32_t getInstanceCount() const { return instanceCount; } // entities drawn last frame
+		double getRecordTime() const { return recordMilliseconds; } // milliseconds renderEntities took last frame, from gathering the entities to the last secondary buffer
+		uint32_t getVisibleCount() const { return visibleCount; } // entities inside the frustum last frame, counted on the cpu path
+		uint32_t getCulledCount() const { return culledCount; } // entities outside the frustum last frame, counted on the cpu path
+		const RenderQueue& getQueue() const { return queue; } // last frame's packets on the cpu path, with the binds and draws before and after sorting
+
+		static constexpr std::array<int, 4> LIGHT_BUCKETS = { 0, 1, 4, MAX_LIGHTS }; // the light counts a shader variant is built for
+		static constexpr size_t MIN_ITEMS_PER_TASK = 1024; // entities worth handing a worker for their matrices and lods
+		static constexpr size_t MIN_DRAWS_PER_TASK = 8; // draws worth recording into a secondary buffer of their own
+		static constexpr uint32_t MIN_INSTANCES_PER_DRAW = 256; // the smallest share a large group is cut into
+		static constexpr uint32_t MIN_INSTANCE_CAPACITY = 4096; // instances a frame's instance buffer starts with room for
 
 	private:
-		void createPipelineLayout(VkDescriptorSetLayout globalSetLayout); // create a pipeline layout
-		void createPipeline(VkRenderPass renderPass); // create a pipeline
+		// an entity to draw this frame, submitted to the render queue so entities sharing a model and lod end up adjacent and drawn as one instanced draw
+		struct DrawItem {
+			Model* model = nullptr;
+			TransformComponent* transform = nullptr;
+			uint32_t lod = 0;
+			bool meshlets = false; // drawn on its own through cpu meshlet culling
+			float depth = 0.f; // distance from the camera to the near side of the bounding sphere
+			glm::mat4 modelMatrix{ 1.f };
+			glm::mat3 normalMatrix{ 1.f };
+		};
+
+		// an instanced draw of consecutive queued items, with its variant resolved before recording starts
+		struct Draw {
+			uint32_t first = 0; // first packet in the queue, also its first instance
+			uint32_t count = 0;
+			Pipeline* pipeline = nullptr;
+		};
+
+		// a shader permutation, built up front and taken from its build the first time it's drawn with
+		struct Variant {
+			PipelineRegistry::Handle handle;
+			std::shared_ptr<Pipeline> pipeline;
+		};
+
+		static uint32_t permutationKey(Model::VertexFormat vertexFormat, size_t lightBucket, bool specular); // pack the variant's options into a key
+		static size_t selectLightBucket(int lightCount); // the smallest bucket that covers the light count
+		Pipeline* getVariant(Model::VertexFormat vertexFormat, size_t lightBucket); // the variant's pipeline, waiting on its build if it hasn't finished
+
+		void createPipelineLayout(PipelineRegistry& pipelineRegistry, VkDescriptorSetLayout globalSetLayout); // get the shared pipeline layout
+		void createPipeline(PipelineRegistry& pipelineRegistry, VkRenderPass renderPass); // request the pipelines
+		void recordEntities(FrameInfo& frameInfo); // cull, sort and record the entities on the cpu path
+		void renderGpuScene(FrameInfo& frameInfo); // one indirect count draw per batch of the gpu scene
+		uint32_t drawMeshlets(VkCommandBuffer commandBuffer, const FrameInfo& frameInfo, Model& model, const glm::mat4& modelMatrix, const glm::mat3& normalMatrix, const Frustum& frustum, uint32_t instance) const; // draw the meshlets that survive frustum and cone culling, returning the draw calls
+		uint32_t selectLod(const Model& model, const glm::mat4& modelMatrix, const FrameInfo& frameInfo) const; // pick the coarsest lod whose projected error is within the threshold
+		Buffer& reserveInstances(int frameIndex, size_t count); // the frame's instance buffer, grown to hold count instances
 		
 		Device& device; // a handle for the device instance
-		std::unique_ptr<Pipeline> pipeline; // a handle for the pipeline instance
-		VkPipelineLayout pipelineLayout; // a handle for the pipeline layout
+		std::unordered_map<uint32_t, Variant> variants = {}; // a handle for the shader variants by permutation key
+		VkPipelineLayout pipelineLayout; // a handle for the pipeline layout, owned by the pipeline registry
+		float lodThreshold = 1.f; // a handle for the allowed projected lod error in pixels
+		bool meshletCulling = true; // a flag for culling meshlets before drawing
+		bool backFaceCulling = false; // a flag for whether the pipelines cull back faces, without it meshlets are only frustum culled
+		bool specular = true; // a flag for drawing with specular highlights
+		std::vector<DrawItem> drawItems = {}; // a handle for this frame's entities to draw, kept to reuse its memory
+		std::vector<Draw> draws = {}; // a handle for this frame's instanced draws, kept to reuse its memory
+		RenderQueue queue = {}; // a handle for this frame's draw packets, indexing drawItems
+		RenderQueue::IdMap bufferIds = {}; // a handle for the sort key id of each vertex and index buffer pair this frame
+		RenderQueue::IdMap meshIds = {}; // a handle for the sort key id of each model and lod this frame
+		std::array<std::unique_ptr<Buffer>, SwapChain::MAX_FRAMES_IN_FLIGHT> instanceBuffers = {}; // a handle for the mapped instance data buffer of each frame in flight
+		SphereList bounds = {}; // a handle for the world space bounding spheres of this frame's entities
+		std::vector<uint8_t> boundsVisible = {}; // a handle for the frustum test result of each sphere in bounds
+		uint32_t visibleCount = 0; // a handle for the entities inside the frustum last frame
+		uint32_t culledCount = 0; // a handle for the entities outside the frustum last frame
+		uint32_t drawCount = 0; // a handle for the draw calls recorded last frame
+		uint32_t instanceCount = 0; // a handle for the entities drawn last frame
+		double recordMilliseconds = 0.0; // a handle for the time renderEntities took last frame
+		ResidencyManager* residencyManager = nullptr; // a handle for the residency manager, if any
+		GpuScene* gpuScene = nullptr; // a handle for the gpu scene, if any
 	};
 }
\ No newline at end of file
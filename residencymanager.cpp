@@ -0,0 +1,148 @@
+#include "residencymanager.hpp"
+#include <algorithm>
+#include <iostream>
+
+namespace ToyBox {
+	ResidencyManager::ResidencyManager(Device& device) : device{ device } {
+		VkPhysicalDeviceMemoryProperties memProperties = device.getMemoryProperties();
+		deviceLocalHeaps.assign(memProperties.memoryHeapCount, false);
+		for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++) {
+			deviceLocalHeaps[i] = (memProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+		}
+		refreshBudget();
+
+		const double megabyte = 1024.0 * 1024.0;
+		std::cout << "residency: device-local budget " << budget / megabyte << " MB, " << usage / megabyte << " MB in use"
+			<< (device.isMemoryBudgetSupported() ? "" : " (estimated, no VK_EXT_memory_budget)") << std::endl;
+	}
+
+	ResidencyManager::~ResidencyManager() {}
+
+	void ResidencyManager::track(const std::shared_ptr<Model>& model) {
+		Entry entry = {};
+		entry.model = model;
+		entry.bytes = model->getDeviceBytes();
+		entry.lastUsedFrame = frame;
+		entry.resident = !model->isEvicted();
+		if (entry.resident) residentBytes += entry.bytes;
+		entries[model.get()] = entry;
+	}
+
+	void ResidencyManager::beginFrame() {
+		frame++;
+		restreamedBytes = 0;
+		device.getUploadBatcher().flush(); // restreams recorded while drawing the last frame
+
+		// forget models that were destroyed, their memory went with them
+		for (auto it = entries.begin(); it != entries.end();) {
+			if (it->second.model.expired()) {
+				if (it->second.resident) residentBytes -= it->second.bytes;
+				it = entries.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+
+		// the arena keeps its pools when models are evicted, so usage doesn't drop afterwards; instead resident geometry
+		// is capped where the pressure started, and restreams evict older models to stay under the cap
+		refreshBudget();
+		const double megabyte = 1024.0 * 1024.0;
+		if (usage > budget * PRESSURE_FRACTION && residentLimit == ~VkDeviceSize(0)) {
+			residentLimit = residentBytes;
+			std::cout << "residency: " << usage / megabyte << " of " << budget / megabyte << " MB used, capping resident geometry at " << residentLimit / megabyte << " MB" << std::endl;
+		}
+		else if (usage < budget * RELIEF_FRACTION && residentLimit != ~VkDeviceSize(0)) {
+			residentLimit = ~VkDeviceSize(0);
+			std::cout << "residency: " << usage / megabyte << " of " << budget / megabyte << " MB used, lifting the resident geometry cap" << std::endl;
+		}
+
+		if (residentBytes > residentLimit) {
+			evictLeastRecentlyUsed(residentBytes - residentLimit);
+		}
+	}
+
+	bool ResidencyManager::request(Model& model) {
+		auto it = entries.find(&model);
+		if (it == entries.end()) return model.isResident();
+
+		Entry& entry = it->second;
+		entry.lastUsedFrame = frame;
+		if (!model.isEvicted()) return model.isResident();
+
+		// spread restreams over frames, the model is skipped until its turn
+		if (restreamedBytes >= restreamBudget) return false;
+		if (residentBytes + entry.bytes > residentLimit) {
+			evictLeastRecentlyUsed(residentBytes + entry.bytes - residentLimit);
+		}
+
+		// an allocation failing here frees more memory and tries once more, the model is drawn later rather than crashing
+		try {
+			model.restream();
+		}
+		catch (const OutOfDeviceMemoryError&) {
+			if (!makeRoom(entry.bytes)) return false;
+			try {
+				model.restream();
+			}
+			catch (const std::exception& e) {
+				std::cerr << "residency: failed to restream model: " << e.what() << std::endl;
+				return false;
+			}
+		}
+		catch (const std::exception& e) {
+			std::cerr << "residency: failed to restream model: " << e.what() << std::endl;
+			return false;
+		}
+
+		entry.resident = true;
+		residentBytes += entry.bytes;
+		restreamedBytes += entry.bytes;
+		restreamCount++;
+		return false; // resident once the upload batch submitted in the next beginFrame finishes
+	}
+
+	bool ResidencyManager::makeRoom(VkDeviceSize bytes) {
+		VkDeviceSize freed = evictLeastRecentlyUsed(bytes);
+		residentLimit = std::min(residentLimit, residentBytes);
+		return freed > 0;
+	}
+
+	void ResidencyManager::refreshBudget() {
+		std::vector<VkDeviceSize> heapBudgets, heapUsages;
+		device.getMemoryBudget(heapBudgets, heapUsages);
+
+		budget = 0;
+		usage = 0;
+		for (size_t i = 0; i < heapBudgets.size(); i++) {
+			if (!deviceLocalHeaps[i]) continue;
+			budget += heapBudgets[i];
+			usage += heapUsages[i];
+		}
+	}
+
+	VkDeviceSize ResidencyManager::evictLeastRecentlyUsed(VkDeviceSize bytes) {
+		// only models no frame in flight can still be drawing are candidates
+		std::vector<Entry*> candidates = {};
+		for (auto& kv : entries) {
+			Entry& entry = kv.second;
+			if (entry.resident && entry.lastUsedFrame + MIN_IDLE_FRAMES <= frame && !entry.model.expired()) candidates.push_back(&entry);
+		}
+		std::sort(candidates.begin(), candidates.end(), [](const Entry* a, const Entry* b) { return a->lastUsedFrame < b->lastUsedFrame; });
+
+		VkDeviceSize freed = 0;
+		for (Entry* entry : candidates) {
+			if (freed >= bytes) break;
+			entry->model.lock()->evict();
+			entry->resident = false;
+			residentBytes -= entry->bytes;
+			freed += entry->bytes;
+			evictionCount++;
+		}
+
+		if (freed > 0) {
+			std::cout << "residency: evicted " << freed / (1024.0 * 1024.0) << " MB of least recently used geometry (" << evictionCount << " evictions so far)" << std::endl;
+		}
+		return freed;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+#include "device.hpp"
+#include "model.hpp"
+#include "swapchain.hpp"
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace ToyBox {
+	// keeps the geometry of tracked models within the device-local memory budget: once usage gets close to the budget,
+	// resident geometry is capped and the least recently used models are evicted back to their host copy to make room,
+	// then streamed in again the next time they're drawn. only used from the main thread
+	class ResidencyManager {
+	public:
+		static constexpr float PRESSURE_FRACTION = 0.9f; // share of the budget above which resident geometry stops growing
+		static constexpr float RELIEF_FRACTION = 0.75f; // share of the budget below which the cap is lifted again
+		static constexpr uint64_t MIN_IDLE_FRAMES = SwapChain::MAX_FRAMES_IN_FLIGHT + 1; // frames a model must go undrawn before it may be evicted
+
+		ResidencyManager(Device& device); // constructor
+		~ResidencyManager(); // destructor
+
+		// not copyable or movable
+		ResidencyManager(const ResidencyManager&) = delete;
+		ResidencyManager& operator = (const ResidencyManager&) = delete;
+
+		void track(const std::shared_ptr<Model>& model); // start managing a model, which stays owned by the caller
+		void beginFrame(); // advance the frame, submit last frame's restreams, refresh the budget and evict down to the cap; call once per frame
+		bool request(Model& model); // mark a model as drawn this frame and restream it if evicted, true if it can be drawn now
+		bool makeRoom(VkDeviceSize bytes); // evict idle models until bytes are freed and lower the cap to match, after an allocation failed
+
+		void setRestreamBudget(VkDeviceSize bytes) { restreamBudget = bytes; } // bytes streamed back in per frame
+		VkDeviceSize getResidentBytes() const { return residentBytes; }
+		VkDeviceSize getBudget() const { return budget; } // device-local budget at the last beginFrame
+		VkDeviceSize getUsage() const { return usage; } // device-local usage at the last beginFrame
+		uint64_t getEvictionCount() const { return evictionCount; }
+		uint64_t getRestreamCount() const { return restreamCount; }
+
+	private:
+		// what the manager knows about one model
+		struct Entry {
+			std::weak_ptr<Model> model;
+			VkDeviceSize bytes = 0;
+			uint64_t lastUsedFrame = 0;
+			bool resident = true;
+		};
+
+		void refreshBudget(); // sum budget and usage over the device-local heaps
+		VkDeviceSize evictLeastRecentlyUsed(VkDeviceSize bytes); // evict idle models, oldest first, returning the bytes freed
+
+		Device& device; // a handle for the device instance
+		std::unordered_map<const Model*, Entry> entries = {}; // a handle for the tracked models
+		std::vector<bool> deviceLocalHeaps = {}; // a handle for which heaps are device local
+		uint64_t frame = 0; // a handle for the frame counter
+		VkDeviceSize budget = 0; // a handle for the device-local budget
+		VkDeviceSize usage = 0; // a handle for the device-local usage
+		VkDeviceSize residentBytes = 0; // a handle for the geometry bytes of the resident tracked models
+		VkDeviceSize residentLimit = ~VkDeviceSize(0); // a handle for the cap on residentBytes, unlimited until the budget gets tight
+		VkDeviceSize restreamBudget = 64 * 1024 * 1024; // a handle for the bytes restreamed per frame
+		VkDeviceSize restreamedBytes = 0; // a handle for the bytes restreamed this frame
+		uint64_t evictionCount = 0; // a handle for the number of evictions
+		uint64_t restreamCount = 0; // a handle for the number of restreams
+	};
+}
\ No newline at end of file
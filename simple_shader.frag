@@ -1,4 +1,5 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
 
 layout (location = 0) in vec3 fragColor;
 layout (location = 1) in vec3 fragPosWorld;
@@ -6,24 +7,11 @@ layout (location = 2) in vec3 fragNormalWorld;
 
 layout (location = 0) out vec4 outColor;
 
-struct PointLight {
-	vec4 position; 
-	vec4 color;
-};
-
-layout(set = 0, binding = 0) uniform GlobalUbo {
-	mat4 projection;
-	mat4 view;
-	mat4 invView;
-	vec4 ambientLightColor;
-	PointLight pointLights[10];
-	int numLights;
-} ubo;
-
-layout(push_constant) uniform Push {
-	mat4 modelMatrix;
-	mat4 normalMatrix;
-} push;
+#include "global_ubo.glsl"
+
+// picked per variant by the pipeline: the loop only runs up to the light bucket, so it can be unrolled or skipped
+layout(constant_id = 0) const int LIGHT_COUNT = MAX_LIGHTS;
+layout(constant_id = 1) const bool SPECULAR = true;
 
 void main() {
 	vec3 diffuseLight = ubo.ambientLightColor.xyz * ubo.ambientLightColor.w;
@@ -33,7 +21,8 @@ void main() {
 	vec3 cameraPosWorld = ubo.invView[3].xyz;
 	vec3 viewDirection = normalize(cameraPosWorld - fragPosWorld);
 
-	for (int i = 0; i < ubo.numLights; i++) {
+	for (int i = 0; i < LIGHT_COUNT; i++) {
+		if (i >= ubo.numLights) break;
 		PointLight light = ubo.pointLights[i];
 		vec3 directionToLight = light.position.xyz - fragPosWorld;
 		float attenuation = 1.0 / dot(directionToLight, directionToLight);
@@ -43,11 +32,13 @@ void main() {
 
 		diffuseLight += intensity * cosAngIncidence;
 
-		vec3 halfAngle = normalize(directionToLight + viewDirection);
-		float blinnTerm = dot(surfaceNormal, halfAngle);
-		blinnTerm = clamp(blinnTerm, 0, 1);
-		blinnTerm = pow(blinnTerm, 512.0); // higher values -> sharper highlight
-		specularLight += intensity * blinnTerm;
+		if (SPECULAR) {
+			vec3 halfAngle = normalize(directionToLight + viewDirection);
+			float blinnTerm = dot(surfaceNormal, halfAngle);
+			blinnTerm = clamp(blinnTerm, 0, 1);
+			blinnTerm = pow(blinnTerm, 512.0); // higher values -> sharper highlight
+			specularLight += intensity * blinnTerm;
+		}
 	}
 
 	outColor = vec4(diffuseLight * fragColor + specularLight * fragColor, 1.0);
@@ -0,0 +1,34 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// Model::PackedVertex; the per-instance model matrix already includes the position dequantization
+layout(location = 0) in vec4 position; // unorm16, within the mesh bounds
+layout(location = 1) in vec4 color; // unorm8
+layout(location = 2) in vec2 normal; // snorm16, octahedral
+layout(location = 3) in vec2 uv; // half float
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+
+#include "global_ubo.glsl"
+
+// RenderSystem::InstanceData, one per entity in the instanced draw
+layout(location = 4) in mat4 modelMatrix;
+layout(location = 8) in mat4 normalMatrix;
+
+vec3 decodeOctahedral(vec2 encoded) {
+	vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+void main() {
+	vec4 positionWorld = modelMatrix * vec4(position.xyz, 1.0);
+	gl_Position = ubo.projection * ubo.view * positionWorld;
+	fragNormalWorld = normalize(mat3(normalMatrix) * decodeOctahedral(normal));
+	fragPosWorld = positionWorld.xyz;
+	fragColor = color.rgb;
+}
\ No newline at end of file
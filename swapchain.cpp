@@ -1,4 +1,5 @@
 #include "swapchain.hpp"
+#include "queuetimeline.hpp"
 #include <array>
 #include <cstdlib>
 #include <cstring>
@@ -42,7 +43,7 @@ namespace ToyBox {
 		for (int i = 0; i < depthImages.size(); i++) {
 			vkDestroyImageView(device.getDevice(), depthImageViews[i], nullptr);
 			vkDestroyImage(device.getDevice(), depthImages[i], nullptr);
-			vkFreeMemory(device.getDevice(), depthImageMemorys[i], nullptr);
+			device.freeMemory(depthImageMemorys[i]);
 		}
 
 		for (auto framebuffer : swapChainFramebuffers) {
@@ -54,42 +55,29 @@ namespace ToyBox {
 		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 			vkDestroySemaphore(device.getDevice(), renderFinishedSemaphores[i], nullptr);
 			vkDestroySemaphore(device.getDevice(), imageAvailableSemaphores[i], nullptr);
-			vkDestroyFence(device.getDevice(), inFlightFences[i], nullptr);
 		}
 	}
 
 	VkResult SwapChain::acquireNextImage(uint32_t* imageIndex) {
-		vkWaitForFences(device.getDevice(), 1, &inFlightFences[currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+		device.getGraphicsTimeline().wait(inFlightValues[currentFrame]); // the last submission of this frame has finished
 		VkResult result = vkAcquireNextImageKHR(device.getDevice(), swapChain, std::numeric_limits<uint64_t>::max(), imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, imageIndex);
 
 		return result;
 	}
 
 	VkResult SwapChain::submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex) {
-		if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
-			vkWaitForFences(device.getDevice(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
-		}
-		imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
-
-		// fill in the VkSubmitInfo struct
-		VkSubmitInfo submitInfo = {};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
-		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-		submitInfo.waitSemaphoreCount = 1;
-		submitInfo.pWaitSemaphores = waitSemaphores;
-		submitInfo.pWaitDstStageMask = waitStages;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = buffers;
-		VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
-		submitInfo.signalSemaphoreCount = 1;
-		submitInfo.pSignalSemaphores = signalSemaphores;
-		vkResetFences(device.getDevice(), 1, &inFlightFences[currentFrame]);
+		// the image may still be rendered to by another frame if images are acquired out of order
+		QueueTimeline& timeline = device.getGraphicsTimeline();
+		timeline.wait(imagesInFlight[*imageIndex]);
 
-		// submit the command buffer
-		if (vkQueueSubmit(device.getGraphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
-			throw std::runtime_error("failed to submit draw command buffer!");
-		}
+		// submit the command buffer, waiting for the image to be available and signalling when rendering has finished
+		VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
+		QueueTimeline::Wait imageAvailable = {};
+		imageAvailable.semaphore = imageAvailableSemaphores[currentFrame];
+		imageAvailable.stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		uint64_t value = timeline.submit(1, buffers, { imageAvailable }, { renderFinishedSemaphores[currentFrame] });
+		inFlightValues[currentFrame] = value;
+		imagesInFlight[*imageIndex] = value;
 
 		// request to present an image to the swap chain
 		VkPresentInfoKHR presentInfo = {};
@@ -101,7 +89,7 @@ namespace ToyBox {
 		presentInfo.pSwapchains = swapchains;
 		presentInfo.pImageIndices = imageIndex;
 		auto result = vkQueuePresentKHR(device.getPresentQueue(), &presentInfo);
-		currentFrame = (currentFrame + 1) & MAX_FRAMES_IN_FLIGHT; // advance to the next frame
+		currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT; // advance to the next frame
 
 		return result;
 	}
@@ -332,22 +320,18 @@ namespace ToyBox {
 		// resize the containers holding the semaphores
 		imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
 		renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-		inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-		imagesInFlight.resize(getImageCount(), VK_NULL_HANDLE);
+		inFlightValues.resize(MAX_FRAMES_IN_FLIGHT, 0); // nothing submitted yet, value 0 has always completed
+		imagesInFlight.resize(getImageCount(), 0);
 
-		// set up semaphore and fence structs
+		// set up the semaphore struct
 		VkSemaphoreCreateInfo semaphoreInfo = {};
 		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-		VkFenceCreateInfo fenceInfo = {};
-		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-		fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
 		// iterate over the frames
 		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-			// create the semaphores and fences
+			// create the semaphores
 			if (vkCreateSemaphore(device.getDevice(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) !=	VK_SUCCESS ||
-				vkCreateSemaphore(device.getDevice(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) !=	VK_SUCCESS ||
-				vkCreateFence(device.getDevice(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
+				vkCreateSemaphore(device.getDevice(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) !=	VK_SUCCESS) {
 				throw std::runtime_error("failed to create synchronization objects for a frame!");
 			}
 		}
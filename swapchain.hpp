@@ -58,7 +58,7 @@ namespace ToyBox {
 		VkRenderPass renderPass; // a handle for the render pass
 
 		std::vector<VkImage> depthImages;
-		std::vector<VkDeviceMemory> depthImageMemorys;
+		std::vector<MemoryAllocation> depthImageMemorys;
 		std::vector<VkImageView> depthImageViews;
 		std::vector<VkImage> swapChainImages; // a handle for the images
 		std::vector<VkImageView> swapChainImageViews; // a handle for image views, describing how to access the image
@@ -71,8 +71,8 @@ namespace ToyBox {
 
 		std::vector<VkSemaphore> imageAvailableSemaphores; // signals that an image has been acquired from the swapchain and is ready for rendering
 		std::vector<VkSemaphore> renderFinishedSemaphores; // signals that rendering has finished and presentation can happen
-		std::vector<VkFence> inFlightFences; // fences to ensure only one frame is rendering at a time
-		std::vector<VkFence> imagesInFlight;
+		std::vector<uint64_t> inFlightValues; // graphics timeline value of each frame's last submission, to keep at most MAX_FRAMES_IN_FLIGHT frames queued
+		std::vector<uint64_t> imagesInFlight; // graphics timeline value of the last submission rendering to each image
 		size_t currentFrame = 0;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include "../objloader.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// standalone checks for ObjLoader, built on their own next to the sources they test:
+// g++ -std=c++17 -I.. objloader_test.cpp ../objloader.cpp ../mappedfile.cpp ../vertextable.cpp
+namespace {
+	int failures = 0;
+
+	void check(bool condition, const char* what) {
+		if (!condition) {
+			std::cerr << "objloader_test: failed " << what << std::endl;
+			failures++;
+		}
+	}
+
+	// write the source to a temporary .obj and load it on one thread
+	bool loadSource(const std::string& source, ToyBox::Model::Builder& builder) {
+		const std::string filepath = "objloader_test.obj";
+		{
+			std::ofstream file{ filepath, std::ios::binary | std::ios::trunc };
+			file << source;
+		}
+
+		bool loaded = true;
+		try {
+			ToyBox::ObjLoader::load(filepath, builder, 1);
+		}
+		catch (const std::exception& e) {
+			std::cerr << "objloader_test: " << e.what() << std::endl;
+			loaded = false;
+		}
+		std::remove(filepath.c_str());
+		return loaded;
+	}
+
+	// a comment after the last corner of a face ends the face, as it does for tinyobj
+	void testFaceComment() {
+		ToyBox::Model::Builder builder = {};
+		check(loadSource("v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\nf 1 2 3 # note\nf 2 4 3#note\n", builder), "face followed by a comment loads");
+		check(builder.indices.size() == 6, "both faces kept their three corners");
+		check(builder.vertices.size() == 4, "the corners share their vertices");
+	}
+
+	// polygons are fanned into triangles around their first corner
+	void testPolygon() {
+		ToyBox::Model::Builder builder = {};
+		check(loadSource("v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf 1/1 2/1 3/1 4/1\r\nvt 0 0\n", builder), "quad loads");
+		check(builder.indices.size() == 6, "quad is two triangles");
+	}
+}
+
+int main() {
+	testFaceComment();
+	testPolygon();
+	if (failures > 0) return EXIT_FAILURE;
+	std::cout << "objloader_test: passed" << std::endl;
+	return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include "../vertextable.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// standalone checks for VertexTable, built on their own next to the sources they test:
+// g++ -std=c++17 -I.. vertextable_test.cpp ../vertextable.cpp
+namespace {
+	int failures = 0;
+
+	void check(bool condition, const char* what) {
+		if (!condition) {
+			std::cerr << "vertextable_test: failed " << what << std::endl;
+			failures++;
+		}
+	}
+
+	ToyBox::Model::Vertex makeVertex(float value) {
+		ToyBox::Model::Vertex vertex = {};
+		vertex.position = { value, value + 1.f, value + 2.f };
+		vertex.normal = { 0.f, 1.f, 0.f };
+		vertex.uv = { value, -value };
+		return vertex;
+	}
+
+	// a table over a non-empty array indexes what's there instead of appending it again
+	void testExistingVertices() {
+		std::vector<ToyBox::Model::Vertex> vertices = { makeVertex(0.f), makeVertex(1.f), makeVertex(2.f) };
+		ToyBox::VertexTable table{ vertices, 4 };
+		check(vertices.size() == 3, "existing vertices are not duplicated");
+
+		check(table.findOrInsert(makeVertex(1.f)) == 1, "existing vertex found at its index");
+		check(table.findOrInsert(makeVertex(3.f)) == 3, "new vertex appended after the existing ones");
+		check(table.findOrInsert(makeVertex(3.f)) == 3, "new vertex found again");
+		check(vertices.size() == 4, "only the new vertex was appended");
+	}
+
+	// growing past the expected count keeps every index
+	void testGrow() {
+		std::vector<ToyBox::Model::Vertex> vertices = { makeVertex(-1.f) };
+		ToyBox::VertexTable table{ vertices, 2 };
+		for (int i = 0; i < 1000; i++) check(table.findOrInsert(makeVertex(static_cast<float>(i))) == static_cast<uint32_t>(i + 1), "index after growing");
+		check(table.findOrInsert(makeVertex(-1.f)) == 0, "existing vertex survives growing");
+		check(vertices.size() == 1001, "vertex count after growing");
+	}
+
+	// merging chunks gives the same result as deduplicating everything in one pass
+	void testMerge() {
+		std::vector<std::vector<ToyBox::Model::Vertex>> chunkVertices = { { makeVertex(0.f), makeVertex(1.f) }, { makeVertex(1.f), makeVertex(2.f) } };
+		std::vector<std::vector<uint32_t>> chunkIndices = { { 0, 1, 0 }, { 1, 0, 1 } };
+		std::vector<ToyBox::Model::Vertex> vertices = {};
+		std::vector<uint32_t> indices = {};
+		ToyBox::VertexTable::merge(chunkVertices, chunkIndices, vertices, indices);
+		check(vertices.size() == 3, "merged vertex count");
+		check(indices == std::vector<uint32_t>({ 0, 1, 0, 2, 1, 2 }), "merged indices");
+	}
+}
+
+int main() {
+	testExistingVertices();
+	testGrow();
+	testMerge();
+	if (failures > 0) return EXIT_FAILURE;
+	std::cout << "vertextable_test: passed" << std::endl;
+	return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#include "threadpool.hpp"
+#include <algorithm>
+
+namespace ToyBox {
+	ThreadPool::ThreadPool(unsigned int threadCount) {
+		if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+		workers.reserve(threadCount);
+		for (unsigned int i = 0; i < threadCount; i++) {
+			workers.emplace_back(&ThreadPool::workerLoop, this);
+		}
+	}
+
+	ThreadPool::~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			stopping = true;
+		}
+		condition.notify_all();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	void ThreadPool::workerLoop() {
+		while (true) {
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock{ mutex };
+				condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+				if (stopping) return;
+				task = std::move(tasks.front());
+				tasks.pop();
+			}
+			task();
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace ToyBox {
+	// fixed set of worker threads running submitted tasks in submission order
+	class ThreadPool {
+	public:
+		explicit ThreadPool(unsigned int threadCount = 0); // constructor, 0 threads means one per hardware thread
+		~ThreadPool(); // destructor, finishes the running tasks and drops the queued ones
+
+		// not copyable or movable
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator = (const ThreadPool&) = delete;
+
+		// queue a task, the future holds its result or rethrows its exception
+		template <typename Task>
+		auto submit(Task&& task) -> std::future<decltype(task())> {
+			using Result = decltype(task());
+			auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<Task>(task));
+			std::future<Result> result = packaged->get_future();
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				tasks.emplace([packaged]() { (*packaged)(); });
+			}
+			condition.notify_one();
+			return result;
+		}
+
+		unsigned int getThreadCount() const { return static_cast<unsigned int>(workers.size()); }
+
+	private:
+		void workerLoop(); // run tasks until the pool is stopped
+
+		std::vector<std::thread> workers = {}; // a handle for the worker threads
+		std::queue<std::function<void()>> tasks = {}; // a handle for the queued tasks
+		std::mutex mutex; // guards tasks and stopping
+		std::condition_variable condition; // signalled when a task is queued or the pool stops
+		bool stopping = false; // a flag for shutting the workers down
+	};
+}
\ No newline at end of file
@@ -0,0 +1,269 @@
+#include "uploadbatcher.hpp"
+#include "buffer.hpp"
+#include "queuetimeline.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace ToyBox {
+	UploadBatcher::UploadBatcher(Device& device, VkDeviceSize stagingSize) : device{ device }, stagingSize{ stagingSize } {
+		// the ring stays mapped for the lifetime of the batcher, coherent memory means no explicit flushes
+		stagingBuffer = std::make_unique<Buffer>(device, stagingSize, 1, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		if (stagingBuffer->map() != VK_SUCCESS) {
+			throw std::runtime_error("failed to map staging ring!");
+		}
+		stagingMemory = static_cast<char*>(stagingBuffer->getMappedMemory());
+
+		QueueFamilyIndices indices = device.findPhysicalQueueFamilies();
+		transferFamily = indices.transferFamily;
+		graphicsFamily = indices.graphicsFamily;
+		ownershipTransfer = indices.dedicatedTransferFamily;
+
+		// a pool of its own so batch command buffers can be reset and reused individually
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = transferFamily;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		if (vkCreateCommandPool(device.getDevice(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create upload command pool!");
+		}
+
+		if (ownershipTransfer) {
+			poolInfo.queueFamilyIndex = graphicsFamily;
+			if (vkCreateCommandPool(device.getDevice(), &poolInfo, nullptr, &acquirePool) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create upload acquire command pool!");
+			}
+		}
+	}
+
+	UploadBatcher::~UploadBatcher() {
+		waitIdle();
+
+		vkDestroyCommandPool(device.getDevice(), commandPool, nullptr); // frees every batch command buffer with it
+		if (acquirePool != VK_NULL_HANDLE) {
+			vkDestroyCommandPool(device.getDevice(), acquirePool, nullptr);
+		}
+	}
+
+	UploadBatcher::BatchId UploadBatcher::upload(VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset) {
+		if (size == 0) return nextBatch - 1;
+
+		// split anything larger than half the ring so a single upload can never need more space than exists
+		const char* source = static_cast<const char*>(data);
+		const VkDeviceSize maxChunk = stagingSize / 2;
+		while (size > 0) {
+			VkDeviceSize chunk = std::min(size, maxChunk);
+			VkDeviceSize offset = 0;
+			while (!allocate(chunk, offset)) {
+				// the ring is full: submit what's recorded so far and wait for the oldest batch to hand its space back
+				flush();
+				retire(true);
+			}
+
+			if (openBatch.commandBuffer == VK_NULL_HANDLE) beginBatch();
+			std::memcpy(stagingMemory + offset, source, static_cast<size_t>(chunk));
+
+			VkBufferCopy copyRegion = {};
+			copyRegion.srcOffset = offset;
+			copyRegion.dstOffset = dstOffset;
+			copyRegion.size = chunk;
+			vkCmdCopyBuffer(openBatch.commandBuffer, stagingBuffer->getBuffer(), dstBuffer, 1, &copyRegion);
+			openBatch.copyCount++;
+
+			// the written range changes hands once the batch is flushed; the chunks of one upload end up in a single barrier
+			if (ownershipTransfer) {
+				VkBufferMemoryBarrier* last = ownershipBarriers.empty() ? nullptr : &ownershipBarriers.back();
+				if (last != nullptr && last->buffer == dstBuffer && last->offset + last->size == dstOffset) {
+					last->size += chunk;
+				}
+				else {
+					VkBufferMemoryBarrier barrier = {};
+					barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+					barrier.srcQueueFamilyIndex = transferFamily;
+					barrier.dstQueueFamilyIndex = graphicsFamily;
+					barrier.buffer = dstBuffer;
+					barrier.offset = dstOffset;
+					barrier.size = chunk;
+					ownershipBarriers.push_back(barrier);
+				}
+			}
+
+			uploadedBytes += chunk;
+			source += chunk;
+			dstOffset += chunk;
+			size -= chunk;
+		}
+
+		return openBatch.id;
+	}
+
+	UploadBatcher::BatchId UploadBatcher::flush() {
+		if (openBatch.copyCount == 0) return nextBatch - 1;
+
+		if (ownershipTransfer) {
+			submitOwnershipTransfer();
+		}
+		else {
+			// make the copies visible to everything that reads geometry afterwards, including later submissions on the queue
+			VkMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = READ_ACCESS;
+			vkCmdPipelineBarrier(openBatch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, READ_STAGES, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+			if (vkEndCommandBuffer(openBatch.commandBuffer) != VK_SUCCESS) {
+				throw std::runtime_error("failed to record upload command buffer!");
+			}
+
+			openBatch.value = device.getTransferTimeline().submit(1, &openBatch.commandBuffer);
+		}
+
+		openBatch.ringEnd = head;
+		BatchId submitted = openBatch.id;
+		inFlight.push_back(openBatch);
+		openBatch = {};
+		nextBatch++;
+		submittedBatchCount++;
+		return submitted;
+	}
+
+	void UploadBatcher::submitOwnershipTransfer() {
+		// release: the transfer queue gives up the written ranges, the destination access is left to the acquire
+		for (auto& barrier : ownershipBarriers) {
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = 0;
+		}
+		vkCmdPipelineBarrier(openBatch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+			0, nullptr, static_cast<uint32_t>(ownershipBarriers.size()), ownershipBarriers.data(), 0, nullptr);
+		if (vkEndCommandBuffer(openBatch.commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record upload command buffer!");
+		}
+
+		// acquire: the same ranges on the graphics queue, made visible to everything that reads geometry afterwards
+		for (auto& barrier : ownershipBarriers) {
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = READ_ACCESS;
+		}
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		if (vkBeginCommandBuffer(openBatch.acquireCommandBuffer, &beginInfo) != VK_SUCCESS) {
+			throw std::runtime_error("failed to begin upload acquire command buffer!");
+		}
+		vkCmdPipelineBarrier(openBatch.acquireCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, READ_STAGES, 0,
+			0, nullptr, static_cast<uint32_t>(ownershipBarriers.size()), ownershipBarriers.data(), 0, nullptr);
+		if (vkEndCommandBuffer(openBatch.acquireCommandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record upload acquire command buffer!");
+		}
+		ownershipBarriers.clear();
+
+		// the acquire waits for the copies' value on the transfer timeline, and its own graphics value completes the batch
+		uint64_t copiesDone = device.getTransferTimeline().submit(1, &openBatch.commandBuffer);
+		QueueTimeline::Wait copies = device.getTransferTimeline().waitFor(copiesDone, VK_PIPELINE_STAGE_TRANSFER_BIT);
+		openBatch.value = device.getGraphicsTimeline().submit(1, &openBatch.acquireCommandBuffer, { copies });
+	}
+
+	bool UploadBatcher::isComplete(BatchId batch) {
+		if (batch > completedBatch) retire(false);
+		return batch <= completedBatch;
+	}
+
+	void UploadBatcher::wait(BatchId batch) {
+		if (batch >= nextBatch) flush();
+		while (completedBatch < batch && !inFlight.empty()) {
+			retire(true);
+		}
+	}
+
+	void UploadBatcher::waitIdle() {
+		flush();
+		wait(nextBatch - 1);
+	}
+
+	void UploadBatcher::beginBatch() {
+		if (!freeBatches.empty()) {
+			openBatch = freeBatches.back();
+			freeBatches.pop_back();
+			vkResetCommandBuffer(openBatch.commandBuffer, 0);
+			if (ownershipTransfer) vkResetCommandBuffer(openBatch.acquireCommandBuffer, 0);
+		}
+		else {
+			VkCommandBufferAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandPool = commandPool;
+			allocInfo.commandBufferCount = 1;
+			if (vkAllocateCommandBuffers(device.getDevice(), &allocInfo, &openBatch.commandBuffer) != VK_SUCCESS) {
+				throw std::runtime_error("failed to allocate upload command buffer!");
+			}
+
+			if (ownershipTransfer) {
+				allocInfo.commandPool = acquirePool;
+				if (vkAllocateCommandBuffers(device.getDevice(), &allocInfo, &openBatch.acquireCommandBuffer) != VK_SUCCESS) {
+					throw std::runtime_error("failed to allocate upload acquire command buffer!");
+				}
+			}
+		}
+		openBatch.id = nextBatch;
+		openBatch.ringEnd = 0;
+		openBatch.copyCount = 0;
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		if (vkBeginCommandBuffer(openBatch.commandBuffer, &beginInfo) != VK_SUCCESS) {
+			throw std::runtime_error("failed to begin upload command buffer!");
+		}
+	}
+
+	bool UploadBatcher::allocate(VkDeviceSize size, VkDeviceSize& offset) {
+		size = (size + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+
+		// nothing recorded or in flight, so the whole ring is free again
+		if (inFlight.empty() && openBatch.copyCount == 0) {
+			head = 0;
+			tail = 0;
+		}
+
+		// head == tail only ever means empty, so an allocation may not make head catch up with tail
+		if (head >= tail) {
+			if (stagingSize - head >= size) {
+				offset = head;
+				head += size;
+				return true;
+			}
+			if (tail > size) {
+				// wrap around, the bytes left at the end stay unused until the tail passes them
+				offset = 0;
+				head = size;
+				return true;
+			}
+		}
+		else if (tail - head > size) {
+			offset = head;
+			head += size;
+			return true;
+		}
+		return false;
+	}
+
+	void UploadBatcher::retire(bool block) {
+		while (!inFlight.empty()) {
+			Batch& batch = inFlight.front();
+			QueueTimeline& timeline = device.getGraphicsTimeline();
+			if (block) {
+				timeline.wait(batch.value);
+				block = false;
+			}
+			else if (!timeline.isComplete(batch.value)) {
+				break;
+			}
+
+			// batch values increase on the graphics timeline, so batches finish in submission order and the tail only moves forward
+			tail = batch.ringEnd;
+			completedBatch = batch.id;
+			freeBatches.push_back(batch);
+			inFlight.pop_front();
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+#pragma once
+#include "device.hpp"
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace ToyBox {
+	class Buffer;
+
+	// streams data into device-local buffers through one persistently mapped staging ring:
+	// uploads are copied into the ring and recorded into the open batch, and each batch is a single timeline submission,
+	// so many buffers share one submission instead of one vkQueueWaitIdle each. copies run on the dedicated transfer queue
+	// when the device has one, releasing the written ranges to the graphics family, which acquires them in a small submission
+	// that waits on the copies' timeline value. a batch is complete once its graphics timeline value is. only used from the main thread
+	class UploadBatcher {
+	public:
+		using BatchId = uint64_t;
+
+		static constexpr VkDeviceSize DEFAULT_STAGING_SIZE = 64 * 1024 * 1024; // bytes in the staging ring
+		static constexpr VkDeviceSize STAGING_ALIGNMENT = 16; // alignment of every suballocation in the ring
+
+		UploadBatcher(Device& device, VkDeviceSize stagingSize = DEFAULT_STAGING_SIZE); // constructor
+		~UploadBatcher(); // destructor, waits for every batch still in flight
+
+		// not copyable or movable
+		UploadBatcher(const UploadBatcher&) = delete;
+		UploadBatcher& operator = (const UploadBatcher&) = delete;
+
+		// copy size bytes of data to dstBuffer at dstOffset, returning the batch the copy belongs to;
+		// uploads bigger than the free ring space are split, submitting and waiting on older batches as needed
+		BatchId upload(VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+		BatchId flush(); // submit the open batch (if it holds any copies) and return the id of the last submitted batch
+
+		bool isComplete(BatchId batch); // poll the graphics timeline, true once the batch has finished on the gpu
+		void wait(BatchId batch); // block until the batch has finished, submitting it first if it's still open
+		void waitIdle(); // submit the open batch and block until every recorded copy has finished
+
+		BatchId getOpenBatch() const { return nextBatch; } // id the next upload will be recorded under
+		VkDeviceSize getStagingSize() const { return stagingSize; }
+		uint64_t getSubmittedBatchCount() const { return submittedBatchCount; }
+		VkDeviceSize getUploadedBytes() const { return uploadedBytes; }
+		bool usesTransferQueue() const { return ownershipTransfer; } // whether copies run on a dedicated transfer queue
+
+	private:
+		// everything that may read uploaded data afterwards
+		static constexpr VkAccessFlags READ_ACCESS = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+		static constexpr VkPipelineStageFlags READ_STAGES = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+		// one command buffer, tagged with the timeline value it signals and recycled once that value is reached
+		struct Batch {
+			BatchId id = 0;
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+			VkCommandBuffer acquireCommandBuffer = VK_NULL_HANDLE; // graphics-side ownership acquire, only with a dedicated transfer queue
+			uint64_t value = 0; // graphics timeline value after which the data is visible and the ring space reusable
+			VkDeviceSize ringEnd = 0; // ring head when the batch was submitted, the ring tail moves here once it retires
+			uint32_t copyCount = 0;
+		};
+
+		void beginBatch(); // start recording the open batch with a recycled or new command buffer
+		bool allocate(VkDeviceSize size, VkDeviceSize& offset); // carve size bytes out of the ring, false if there is no room yet
+		void retire(bool block); // free the ring space of finished batches, blocking on the oldest one if asked to
+		void submitOwnershipTransfer(); // release the written ranges on the transfer queue and acquire them on the graphics queue
+
+		Device& device; // a handle for the device instance
+		VkDeviceSize stagingSize; // a handle for the size of the staging ring
+		std::unique_ptr<Buffer> stagingBuffer; // a handle for the persistently mapped staging ring
+		char* stagingMemory = nullptr; // a handle for the mapped ring memory
+		VkCommandPool commandPool = VK_NULL_HANDLE; // a handle for the pool the batch command buffers come from
+		VkCommandPool acquirePool = VK_NULL_HANDLE; // a handle for the graphics pool the acquire command buffers come from
+		uint32_t transferFamily = 0; // a handle for the queue family the copies run on
+		uint32_t graphicsFamily = 0; // a handle for the queue family that reads the uploaded data
+		bool ownershipTransfer = false; // a handle for whether the two families differ
+		std::vector<VkBufferMemoryBarrier> ownershipBarriers = {}; // a handle for the ranges written by the open batch, adjacent copies merged
+
+		VkDeviceSize head = 0; // a handle for where the next allocation starts
+		VkDeviceSize tail = 0; // a handle for the start of the oldest allocation still in use
+		Batch openBatch = {}; // a handle for the batch being recorded
+		std::deque<Batch> inFlight = {}; // a handle for the submitted batches, oldest first
+		std::vector<Batch> freeBatches = {}; // a handle for the retired batches ready for reuse
+
+		BatchId nextBatch = 1; // a handle for the id of the open batch
+		BatchId completedBatch = 0; // a handle for the newest batch known to be finished, batches retire in submission order
+		uint64_t submittedBatchCount = 0; // a handle for the number of submissions made
+		VkDeviceSize uploadedBytes = 0; // a handle for the total bytes uploaded
+	};
+}
\ No newline at end of file
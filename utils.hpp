@@ -1,4 +1,6 @@
 #pragma once
+#include <cstdint>
+#include <cstring>
 #include <functional>
 
 namespace ToyBox {
@@ -10,4 +12,26 @@ namespace ToyBox {
 		(hashCombine(seed, rest), ...);
 	};
 
+	// 64-bit hash of a block of memory, consuming 8 bytes per step (used for file contents and other large keys)
+	inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0) {
+		constexpr uint64_t prime = 0x9e3779b97f4a7c15ull;
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		uint64_t hash = seed ^ (size * prime);
+
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8) {
+			uint64_t word;
+			std::memcpy(&word, bytes + i, sizeof(word));
+			hash = (hash ^ (word * prime)) * prime;
+			hash ^= hash >> 29;
+		}
+
+		// fold in the remaining tail bytes
+		uint64_t tail = 0;
+		std::memcpy(&tail, bytes + i, size - i);
+		hash = (hash ^ (tail * prime)) * prime;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
 }  // namespace lve
@@ -0,0 +1,111 @@
+#include "vertexquantizer.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ToyBox {
+	namespace {
+		constexpr float UNORM16_MAX = 65535.f;
+		constexpr float SNORM16_MAX = 32767.f;
+		constexpr float UNORM8_MAX = 255.f;
+
+		uint16_t quantizeUnorm16(float value) {
+			return static_cast<uint16_t>(std::lround(glm::clamp(value, 0.f, 1.f) * UNORM16_MAX));
+		}
+
+		int16_t quantizeSnorm16(float value) {
+			return static_cast<int16_t>(std::lround(glm::clamp(value, -1.f, 1.f) * SNORM16_MAX));
+		}
+
+		uint8_t quantizeUnorm8(float value) {
+			return static_cast<uint8_t>(std::lround(glm::clamp(value, 0.f, 1.f) * UNORM8_MAX));
+		}
+	}
+
+	void VertexQuantizer::encodeOctahedral(const glm::vec3& normal, int16_t encoded[2]) {
+		// project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half over the diagonals
+		float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+		if (sum == 0.f) {
+			encoded[0] = encoded[1] = 0;
+			return;
+		}
+
+		float x = normal.x / sum;
+		float y = normal.y / sum;
+		if (normal.z < 0.f) {
+			float foldedX = (1.f - std::abs(y)) * (x >= 0.f ? 1.f : -1.f);
+			float foldedY = (1.f - std::abs(x)) * (y >= 0.f ? 1.f : -1.f);
+			x = foldedX;
+			y = foldedY;
+		}
+		encoded[0] = quantizeSnorm16(x);
+		encoded[1] = quantizeSnorm16(y);
+	}
+
+	glm::vec3 VertexQuantizer::decodeOctahedral(const int16_t encoded[2]) {
+		// same as decodeOctahedral in simple_shader_packed.vert
+		float x = std::max(encoded[0] / SNORM16_MAX, -1.f);
+		float y = std::max(encoded[1] / SNORM16_MAX, -1.f);
+		glm::vec3 normal{ x, y, 1.f - std::abs(x) - std::abs(y) };
+		float t = std::max(-normal.z, 0.f);
+		normal.x += normal.x >= 0.f ? -t : t;
+		normal.y += normal.y >= 0.f ? -t : t;
+		return glm::normalize(normal);
+	}
+
+	glm::mat4 VertexQuantizer::pack(const Model::Builder& builder, std::vector<Model::PackedVertex>& packed, QuantizationError& error) {
+		error = {};
+		packed.resize(builder.vertices.size());
+		if (builder.vertices.empty()) return glm::mat4{ 1.f };
+
+		// quantize against the vertices' own bounds rather than the builder's, which may not have been computed
+		glm::vec3 boundsMin{ std::numeric_limits<float>::max() };
+		glm::vec3 boundsMax{ std::numeric_limits<float>::lowest() };
+		for (const auto& vertex : builder.vertices) {
+			boundsMin = glm::min(boundsMin, vertex.position);
+			boundsMax = glm::max(boundsMax, vertex.position);
+		}
+		const glm::vec3 extent = boundsMax - boundsMin;
+		glm::vec3 inverseExtent = {};
+		for (int axis = 0; axis < 3; axis++) {
+			inverseExtent[axis] = extent[axis] > 0.f ? 1.f / extent[axis] : 0.f;
+		}
+
+		for (size_t i = 0; i < builder.vertices.size(); i++) {
+			const Model::Vertex& vertex = builder.vertices[i];
+			Model::PackedVertex& out = packed[i];
+
+			glm::vec3 normalizedPosition = (vertex.position - boundsMin) * inverseExtent;
+			glm::vec3 decodedPosition = {};
+			for (int axis = 0; axis < 3; axis++) {
+				out.position[axis] = quantizeUnorm16(normalizedPosition[axis]);
+				decodedPosition[axis] = boundsMin[axis] + out.position[axis] / UNORM16_MAX * extent[axis];
+			}
+			out.position[3] = 0;
+			error.position = std::max(error.position, glm::length(decodedPosition - vertex.position));
+
+			for (int channel = 0; channel < 3; channel++) {
+				out.color[channel] = quantizeUnorm8(vertex.color[channel]);
+				error.color = std::max(error.color, std::abs(out.color[channel] / UNORM8_MAX - vertex.color[channel]));
+			}
+			out.color[3] = static_cast<uint8_t>(UNORM8_MAX);
+
+			encodeOctahedral(vertex.normal, out.normal);
+			float normalLength = glm::length(vertex.normal);
+			if (normalLength > 0.f) {
+				float cosAngle = glm::clamp(glm::dot(decodeOctahedral(out.normal), vertex.normal / normalLength), -1.f, 1.f);
+				error.normal = std::max(error.normal, glm::degrees(std::acos(cosAngle)));
+			}
+
+			for (int component = 0; component < 2; component++) {
+				out.uv[component] = glm::packHalf1x16(vertex.uv[component]);
+				error.uv = std::max(error.uv, std::abs(glm::unpackHalf1x16(out.uv[component]) - vertex.uv[component]));
+			}
+		}
+
+		// the shader reads positions as unorm in [0, 1], so scale by the extent and move to the bounds minimum
+		return glm::scale(glm::translate(glm::mat4{ 1.f }, boundsMin), extent);
+	}
+}
\ No newline at end of file
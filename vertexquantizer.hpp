@@ -0,0 +1,23 @@
+#pragma once
+#include "model.hpp"
+#include <vector>
+
+namespace ToyBox {
+	// converts Model::Vertex data into Model::PackedVertex and measures what the conversion lost
+	class VertexQuantizer {
+	public:
+		// largest error introduced for each attribute, in the units of the source data
+		struct QuantizationError {
+			float position = 0.f; // model space distance
+			float normal = 0.f; // degrees
+			float color = 0.f; // per channel
+			float uv = 0.f; // per component
+		};
+
+		// pack the builder's vertices and return the matrix that maps packed positions back to model space
+		static glm::mat4 pack(const Model::Builder& builder, std::vector<Model::PackedVertex>& packed, QuantizationError& error);
+
+		static void encodeOctahedral(const glm::vec3& normal, int16_t encoded[2]);
+		static glm::vec3 decodeOctahedral(const int16_t encoded[2]);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,141 @@
+#include "vertextable.hpp"
+#include <cstring>
+#include <future>
+#include <stdexcept>
+#include <type_traits>
+
+namespace ToyBox {
+	namespace {
+		constexpr size_t VERTEX_WORDS = sizeof(Model::Vertex) / sizeof(uint32_t);
+		static_assert(sizeof(Model::Vertex) % sizeof(uint32_t) == 0, "vertices are hashed as 32-bit words");
+		static_assert(std::is_trivially_copyable<Model::Vertex>::value, "vertices are compared bytewise");
+
+		// vertices are compared bit for bit, which only differs from Vertex::operator== for -0.0 and NaN components
+		bool sameVertex(const Model::Vertex& a, const Model::Vertex& b) {
+			return std::memcmp(&a, &b, sizeof(Model::Vertex)) == 0;
+		}
+
+		size_t nextPowerOfTwo(size_t value) {
+			size_t result = 16;
+			while (result < value) result <<= 1;
+			return result;
+		}
+	}
+
+	VertexTable::VertexTable(std::vector<Model::Vertex>& vertices, size_t expectedCount) : vertices{ vertices } {
+		// keep the load factor at or below 3/4 for the vertices already in the array plus the expected count
+		const size_t capacity = vertices.size() + expectedCount;
+		slots.resize(nextPowerOfTwo(capacity + capacity / 3));
+		mask = slots.size() - 1;
+		vertices.reserve(capacity);
+		rehash(); // the vertices already in the array are indexed where they are, not appended again
+	}
+
+	uint64_t VertexTable::hash(const Model::Vertex& vertex) {
+		uint32_t words[VERTEX_WORDS];
+		std::memcpy(words, &vertex, sizeof(words));
+
+		// every word gets its own odd 64-bit multiplier and the products are summed, so the multiplies don't depend
+		// on each other the way the rounds of a serial hash do
+		static constexpr uint64_t keys[VERTEX_WORDS] = {
+			0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full, 0x165667b19e3779f9ull, 0xd6e8feb86659fd93ull,
+			0xff51afd7ed558ccdull, 0xc4ceb9fe1a85ec53ull, 0x27d4eb2f165667c5ull, 0x94d049bb133111ebull,
+			0xbf58476d1ce4e5b9ull, 0x85ebca77c2b2ae63ull, 0xa0761d6478bd642full,
+		};
+		uint64_t sum = 0;
+		for (size_t i = 0; i < VERTEX_WORDS; i++) {
+			sum += (words[i] + keys[i]) * keys[(i + 5) % VERTEX_WORDS];
+		}
+
+		// final avalanche so both the slot bits and the tag bits depend on every input word
+		sum ^= sum >> 32;
+		sum *= 0xd6e8feb86659fd93ull;
+		sum ^= sum >> 32;
+		return sum;
+	}
+
+	uint32_t VertexTable::findOrInsert(const Model::Vertex& vertex) {
+		const uint64_t vertexHash = hash(vertex);
+		const uint32_t tag = static_cast<uint32_t>(vertexHash >> 32);
+
+		// linear probing from the home slot until we hit the vertex or an empty slot
+		for (size_t slot = vertexHash & mask;; slot = (slot + 1) & mask) {
+			Slot& entry = slots[slot];
+			if (entry.index == 0) {
+				if ((vertices.size() + 1) * 4 > slots.size() * 3) {
+					grow();
+					return findOrInsert(vertex);
+				}
+				if (vertices.size() >= UINT32_MAX) {
+					throw std::runtime_error("too many unique vertices for 32-bit indices!");
+				}
+
+				vertices.push_back(vertex);
+				entry.hashTag = tag;
+				entry.index = static_cast<uint32_t>(vertices.size());
+				return entry.index - 1;
+			}
+
+			if (entry.hashTag == tag && sameVertex(vertices[entry.index - 1], vertex)) {
+				return entry.index - 1;
+			}
+		}
+	}
+
+	void VertexTable::grow() {
+		slots.assign(slots.size() * 2, Slot{});
+		mask = slots.size() - 1;
+		rehash();
+	}
+
+	void VertexTable::rehash() {
+		for (uint32_t i = 0; i < vertices.size(); i++) {
+			const uint64_t vertexHash = hash(vertices[i]);
+			size_t slot = vertexHash & mask;
+			while (slots[slot].index != 0) slot = (slot + 1) & mask;
+			slots[slot] = { static_cast<uint32_t>(vertexHash >> 32), i + 1 };
+		}
+	}
+
+	void VertexTable::merge(std::vector<std::vector<Model::Vertex>>& chunkVertices, std::vector<std::vector<uint32_t>>& chunkIndices, std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices) {
+		const size_t chunkCount = chunkVertices.size();
+
+		size_t vertexCount = 0, indexCount = 0;
+		std::vector<size_t> indexOffsets(chunkCount);
+		for (size_t i = 0; i < chunkCount; i++) {
+			vertexCount += chunkVertices[i].size();
+			indexOffsets[i] = indexCount;
+			indexCount += chunkIndices[i].size();
+		}
+
+		vertices.clear();
+		indices.resize(indexCount);
+
+		// the merge only touches each chunk's unique vertices, which is far less work than the per-corner pass
+		std::vector<std::vector<uint32_t>> remaps(chunkCount);
+		VertexTable table{ vertices, vertexCount };
+		for (size_t i = 0; i < chunkCount; i++) {
+			remaps[i].resize(chunkVertices[i].size());
+			for (size_t v = 0; v < chunkVertices[i].size(); v++) {
+				remaps[i][v] = table.findOrInsert(chunkVertices[i][v]);
+			}
+			chunkVertices[i] = {};
+		}
+
+		// rewrite each chunk's indices into its slice of the final index list in parallel
+		auto remapChunk = [&](size_t i) {
+			uint32_t* out = indices.data() + indexOffsets[i];
+			for (uint32_t index : chunkIndices[i]) {
+				*out++ = remaps[i][index];
+			}
+			chunkIndices[i] = {};
+		};
+
+		std::vector<std::future<void>> tasks = {};
+		for (size_t i = 1; i < chunkCount; i++) {
+			tasks.push_back(std::async(std::launch::async, remapChunk, i));
+		}
+		if (chunkCount > 0) remapChunk(0);
+		for (auto& task : tasks) task.get();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+#include "model.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace ToyBox {
+	// flat open-addressing hash table that deduplicates vertices into a vertex array,
+	// storing only 32-bit indices into that array so a lookup never touches a heap node
+	class VertexTable {
+	public:
+		VertexTable(std::vector<Model::Vertex>& vertices, size_t expectedCount); // constructor, indexes the vertices already in the array and makes room for expectedCount more (e.g. the index count)
+
+		// not copyable or movable
+		VertexTable(const VertexTable&) = delete;
+		VertexTable& operator = (const VertexTable&) = delete;
+
+		uint32_t findOrInsert(const Model::Vertex& vertex); // return the index of an equal vertex, appending it first if it is new
+		static uint64_t hash(const Model::Vertex& vertex); // multilinear hash over the vertex's 32-bit words
+
+		// merge chunks that were deduplicated independently (e.g. on worker threads) into one vertex/index list;
+		// chunks are merged in order, so the result is the same as deduplicating everything in one pass
+		static void merge(std::vector<std::vector<Model::Vertex>>& chunkVertices, std::vector<std::vector<uint32_t>>& chunkIndices, std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	private:
+		// a slot holds the upper bits of the vertex hash to reject most mismatches without comparing vertices
+		struct Slot {
+			uint32_t hashTag;
+			uint32_t index; // index into the vertex array plus one, zero marks an empty slot
+		};
+
+		void grow(); // double the slot count and reinsert every vertex
+		void rehash(); // insert every vertex of the array into the empty slots, without touching the array
+
+		std::vector<Model::Vertex>& vertices; // a handle for the deduplicated vertex array
+		std::vector<Slot> slots = {}; // the open-addressing slots, always a power of two
+		size_t mask = 0; // slot count minus one
+	};
+}
\ No newline at end of file